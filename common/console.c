@@ -6,6 +6,7 @@
 #include <string.h>
 
 #include <console.h>
+#include <crc16.h>
 
 #define ESC_UP	  0x5b41
 #define ESC_DOWN  0x5b42
@@ -20,6 +21,8 @@
 #define ESC_END	 0x5b46
 #define ESC_HOME 0x5b48
 
+#define CONSOLE_NESTING_MAX 4
+
 static inline uint32_t hexchar2uint(char ch)
 {
 	if (ch >= '0' && ch <= '9')
@@ -32,9 +35,9 @@ static inline uint32_t hexchar2uint(char ch)
 		return (uint32_t)-1;
 }
 
-static uint32_t str2uint(char *s, bool *ok)
+static uintptr_t str2uint(char *s, bool *ok)
 {
-	uint32_t value = 0;
+	uintptr_t value = 0;
 	uint32_t val_char;
 
 	if (s[0] == '0' && s[1] == 'x') {
@@ -69,7 +72,7 @@ static uint32_t str2uint(char *s, bool *ok)
 	return value;
 }
 
-static void console_find_cmd(struct console *console, char *line, struct console_arg *args,
+static bool console_find_cmd(struct console *console, char *line, struct console_arg *args,
 			     int argc)
 {
 	struct console_cmd *cmd = NULL;
@@ -80,35 +83,50 @@ static void console_find_cmd(struct console *console, char *line, struct console
 			cmd = &console->cmds[i];
 			if (argc < console->cmds[i].arg_min || argc > console->cmds[i].arg_max) {
 				uart_puts(console->uart, "Error: Wrong arguments count\n");
-				return;
+				return false;
 			}
 			for (int j = 0; j < argc; j++) {
-				if (console->cmds[i].arg_types[j] == ARG_UINT) {
-					args[j].uint = str2uint(args[j].str, &ok);
+				if (console->cmds[i].arg_types[j] == ARG_UINT ||
+				    console->cmds[i].arg_types[j] == ARG_INT ||
+				    console->cmds[i].arg_types[j] == ARG_ADDR) {
+					bool is_neg = console->cmds[i].arg_types[j] == ARG_INT &&
+						      args[j].str[0] == '-';
+
+					args[j].addr = str2uint(args[j].str + is_neg, &ok);
+					if (is_neg) {
+						args[j].addr = -args[j].addr;
+						ok = ok && args[j].str[1];
+					}
+
+					args[j].uint = args[j].addr;
 					if (!ok) {
 						uart_printf(console->uart,
 							    "Error: Argument %d must be integer\n",
 							    j);
-						return;
+						return false;
 					}
-				} else
+				} else {
 					args[j].uint = 0;
+					args[j].addr = 0;
+				}
 			}
 			break;
 		}
 	}
 	if (!cmd) {
 		uart_printf(console->uart, "Error: Unknown command '%s'\n", line);
-		return;
+		return false;
 	}
 	if (console->run_cmd)
 		console->run_cmd(console, cmd, args, argc);
+
+	return true;
 }
 
-static void console_parse(struct console *console)
+/* Run single command. Return false if command can not be parsed */
+static bool console_exec(struct console *console, char *line)
 {
 	struct console_arg args[5];
-	char *line = console->line;
 	int argc = 0;
 	int size;
 	bool last_space = false;
@@ -127,7 +145,7 @@ static void console_parse(struct console *console)
 			if (last_space) {
 				if (argc >= 5) {
 					uart_puts(console->uart, "Error: Too many arguments\n");
-					return;
+					return false;
 				}
 				args[argc++].str = &line[i];
 				last_space = false;
@@ -139,30 +157,363 @@ static void console_parse(struct console *console)
 			uart_puts(console->uart, console->each_line_msg);
 			uart_putc(console->uart, '\n');
 		}
+		return true;
+	}
+
+	return console_find_cmd(console, line, args, argc);
+}
+
+/* If line starts with word `word` then return pointer to the rest of line (spaces after the
+ * word are skipped), otherwise return NULL.
+ */
+static char *console_match_word(char *line, const char *word)
+{
+	while (*word) {
+		if (*line++ != *word++)
+			return NULL;
+	}
+
+	if (*line != '\0' && *line != ' ')
+		return NULL;
+
+	while (*line == ' ')
+		line++;
+
+	return line;
+}
+
+static void console_strcpy(char *dst, const char *src, int size)
+{
+	int i;
+
+	for (i = 0; i < size - 1 && src[i]; i++)
+		dst[i] = src[i];
+
+	dst[i] = '\0';
+}
+
+/* Parse repeat count. On success `line` points to the rest of line after the count */
+static bool console_parse_count(struct console *console, char **line, uint32_t *count)
+{
+	char *s = *line;
+	char *end = s;
+	bool ok = false;
+
+	while (*end && *end != ' ')
+		end++;
+
+	if (*end) {
+		*end = '\0';
+		*count = str2uint(s, &ok);
+		for (end++; *end == ' '; end++) {
+		}
+	} else if (*s)
+		*count = str2uint(s, &ok);
+
+	if (!ok) {
+		uart_puts(console->uart, "Error: Count must be integer\n");
+		return false;
+	}
+	*line = end;
+
+	return true;
+}
+
+/* Run command list. Commands are separated by ';'. Built-in commands:
+ *   repeat <n> <cmds> - run the rest of line n times;
+ *   script [cmds] - store the rest of line for replay (print stored commands if it is empty);
+ *   replay [n] - run stored commands n times (once by default).
+ * Processing stops at the first command that can not be parsed.
+ * depth - nesting level of repeat and replay, each level uses own copy of commands.
+ */
+static bool console_run_list(struct console *console, char *line, int depth)
+{
+	char buf[CONSOLE_LINE_SIZE];
+	uint32_t count;
+	char *rest;
+	char *next;
+
+	if (depth > CONSOLE_NESTING_MAX) {
+		uart_puts(console->uart, "Error: Too deep nesting of repeat/replay\n");
+		return false;
+	}
+
+	while (1) {
+		while (*line == ' ')
+			line++;
+
+		rest = console_match_word(line, "script");
+		if (rest) {
+			if (*rest)
+				console_strcpy(console->script, rest, sizeof(console->script));
+			else
+				uart_printf(console->uart, "%s\n", console->script);
+
+			return true;
+		}
+
+		rest = console_match_word(line, "repeat");
+		if (rest) {
+			if (!console_parse_count(console, &rest, &count))
+				return false;
+
+			for (uint32_t i = 0; i < count; i++) {
+				console_strcpy(buf, rest, sizeof(buf));
+				if (!console_run_list(console, buf, depth + 1))
+					return false;
+			}
+
+			return true;
+		}
+
+		for (next = line; *next && *next != ';'; next++) {
+		}
+
+		if (*next)
+			*next++ = '\0';
+		else
+			next = NULL;
+
+		rest = console_match_word(line, "replay");
+		if (rest) {
+			count = 1;
+			if (*rest && !console_parse_count(console, &rest, &count))
+				return false;
+
+			for (uint32_t i = 0; i < count; i++) {
+				console_strcpy(buf, console->script, sizeof(buf));
+				if (!console_run_list(console, buf, depth + 1))
+					return false;
+			}
+		} else if (*line && !console_exec(console, line)) {
+			return false;
+		}
+
+		if (!next)
+			return true;
+
+		line = next;
+	}
+}
+
+static void console_parse(struct console *console)
+{
+	char *line = console->line;
+
+	while (*line == ' ')
+		line++;
+
+	// Empty line prints each_line_msg
+	if (*line == '\0') {
+		console_exec(console, line);
+		return;
+	}
+
+	console_run_list(console, line, 0);
+}
+
+void console_rpc_send(struct console *console, const void *buf, uint32_t len)
+{
+	const uint8_t *p = buf;
+
+	for (uint32_t i = 0; i < len; i++) {
+		console->rpc_crc = crc16_update_byte(console->rpc_crc, p[i]);
+		uart_putc_raw(console->uart, p[i]);
+	}
+}
+
+void console_rpc_reply_start(struct console *console, uint8_t status, uint16_t len)
+{
+	uint8_t header[3] = { status, len & 0xff, len >> 8 };
+
+	console->rpc_status = status;
+	console_rpc_send(console, header, sizeof(header));
+}
+
+void console_rpc_reply(struct console *console, uint8_t status, const void *buf, uint16_t len)
+{
+	console_rpc_reply_start(console, status, len);
+	console_rpc_send(console, buf, len);
+}
+
+static uint32_t get_le(uint8_t *buf, int size)
+{
+	uint32_t value = 0;
+
+	for (int i = size - 1; i >= 0; i--)
+		value = (value << 8) | buf[i];
+
+	return value;
+}
+
+/* Parse arguments of one RPC operation. Integer arguments are 32-bit little-endian values,
+ * ARG_ADDR arguments are 64-bit little-endian values, string arguments are length byte
+ * followed by characters. Strings are moved one byte back (over length byte) to make room
+ * for terminating '\0'.
+ * Return count of arguments or -1 if arguments do not match the command.
+ */
+static int console_rpc_parse_args(struct console_cmd *cmd, uint8_t *buf, uint32_t len, int argc,
+				  struct console_arg *args)
+{
+	uint32_t pos = 0;
+
+	for (int i = 0; i < CONSOLE_RPC_ARGS_MAX; i++) {
+		args[i].str = NULL;
+		args[i].uint = 0;
+		args[i].addr = 0;
+	}
+
+	if (argc < cmd->arg_min || argc > cmd->arg_max)
+		return -1;
+
+	for (int i = 0; i < argc; i++) {
+		uint32_t size = 4;
+
+		if (cmd->arg_types[i] == ARG_ADDR)
+			size = 8;
+		else if (cmd->arg_types[i] == ARG_STR && pos < len)
+			size = 1 + buf[pos];
+
+		if (pos + size > len)
+			return -1;
+
+		if (cmd->arg_types[i] == ARG_STR) {
+			for (uint32_t j = 0; j < size - 1; j++)
+				buf[pos + j] = buf[pos + j + 1];
+
+			buf[pos + size - 1] = '\0';
+			args[i].str = (char *)&buf[pos];
+		} else {
+			args[i].uint = get_le(&buf[pos], 4);
+			args[i].addr = args[i].uint;
+			if (size == 8 && sizeof(uintptr_t) > 4)
+				args[i].addr |= (uintptr_t)get_le(&buf[pos + 4], 4) << 16 << 16;
+		}
+		pos += size;
+	}
+
+	return pos == len ? argc : -1;
+}
+
+/* Receive and run binary RPC frame. STX is already received.
+ * Request: | STX | len_lo | len_hi | crc_lo | crc_hi | payload |, CRC16 is calculated for payload.
+ * Payload: | count | operation 1 | ... | operation N |.
+ * Operation: | cmd_id | argc | args_len | data_len_lo | data_len_hi | args | data |.
+ * Reply: | STX | result 1 | ... | result N | crc_lo | crc_hi |, CRC16 is calculated for results.
+ * Result: | status | len_lo | len_hi | payload |.
+ * Operations are run in order. If some operation fails, the rest are not run and their status
+ * is CONSOLE_RPC_ERR_SKIPPED. Request with wrong CRC or size is answered by | NAK | code |.
+ */
+static void console_rpc(struct console *console)
+{
+	struct console_arg args[CONSOLE_RPC_ARGS_MAX];
+	uint8_t buf[CONSOLE_RPC_SIZE];
+	uint16_t len;
+	uint16_t expected_crc;
+	uint16_t crc = crc16_init();
+	uint32_t pos = 1;
+	uint8_t status = CONSOLE_RPC_OK;
+	int count;
+
+	len = uart_getchar(console->uart);
+	len |= (uint16_t)uart_getchar(console->uart) << 8;
+	expected_crc = uart_getchar(console->uart);
+	expected_crc |= (uint16_t)uart_getchar(console->uart) << 8;
+	for (uint32_t i = 0; i < len; i++) {
+		uint8_t ch = uart_getchar(console->uart);
+
+		crc = crc16_update_byte(crc, ch);
+		if (i < sizeof(buf))
+			buf[i] = ch;
+	}
+
+	if (!len || len > sizeof(buf)) {
+		uart_putc_raw(console->uart, CONSOLE_RPC_NAK);
+		uart_putc_raw(console->uart, CONSOLE_RPC_NAK_SIZE);
+		return;
+	} else if (crc != expected_crc) {
+		uart_putc_raw(console->uart, CONSOLE_RPC_NAK);
+		uart_putc_raw(console->uart, CONSOLE_RPC_NAK_CRC);
 		return;
 	}
 
-	console_find_cmd(console, line, args, argc);
+	count = buf[0];
+	console->rpc_crc = crc16_init();
+	uart_putc_raw(console->uart, CONSOLE_RPC_STX);
+	for (int i = 0; i < count; i++) {
+		struct console_cmd *cmd = NULL;
+		uint32_t args_len;
+		uint32_t data_len;
+		int argc;
+
+		console->rpc_status = -1;
+		if (status != CONSOLE_RPC_OK) {
+			console_rpc_reply(console, CONSOLE_RPC_ERR_SKIPPED, NULL, 0);
+			continue;
+		}
+
+		if (pos + 5 > len) {
+			status = CONSOLE_RPC_ERR_ARGS;
+			console_rpc_reply(console, status, NULL, 0);
+			continue;
+		}
+
+		args_len = buf[pos + 2];
+		data_len = get_le(&buf[pos + 3], 2);
+		if (pos + 5 + args_len + data_len > len) {
+			status = CONSOLE_RPC_ERR_ARGS;
+			console_rpc_reply(console, status, NULL, 0);
+			continue;
+		}
+
+		for (int j = 0; j < console->cmds_count; j++) {
+			if (console->cmds[j].cmd_id == buf[pos])
+				cmd = &console->cmds[j];
+		}
+
+		argc = buf[pos + 1];
+		if (!cmd)
+			status = CONSOLE_RPC_ERR_UNKNOWN_CMD;
+		else if (argc > CONSOLE_RPC_ARGS_MAX ||
+			 console_rpc_parse_args(cmd, &buf[pos + 5], args_len, argc, args) < 0)
+			status = CONSOLE_RPC_ERR_ARGS;
+		else {
+			status = console->run_rpc(console, cmd, args, argc,
+						  &buf[pos + 5 + args_len], data_len);
+			if (console->rpc_status >= 0)
+				status = console->rpc_status;
+		}
+
+		if (console->rpc_status < 0)
+			console_rpc_reply(console, status, NULL, 0);
+
+		pos += 5 + args_len + data_len;
+	}
+
+	crc = console->rpc_crc;
+	uart_putc_raw(console->uart, crc & 0xff);
+	uart_putc_raw(console->uart, crc >> 8);
 }
 
 static void console_move_coursor(struct console *console, int shift, bool to_left)
 {
-	char buf[6] = "\x1b[0\0\0\0";
+	char buf[7] = "\x1b[\0\0\0\0";
 	char dir = to_left ? 'D' : 'C';
+	int pos = 2;
 
 	if (!shift)
 		return;
-	else if (shift > 99)
-		shift = 99;
+	else if (shift > 999)
+		shift = 999;
 
-	if (shift < 10) {
-		buf[2] = shift + '0';
-		buf[3] = dir;
-	} else {
-		buf[2] = shift / 10 + '0';
-		buf[3] = shift % 10 + '0';
-		buf[4] = dir;
-	}
+	if (shift >= 100)
+		buf[pos++] = shift / 100 + '0';
+
+	if (shift >= 10)
+		buf[pos++] = shift / 10 % 10 + '0';
+
+	buf[pos++] = shift % 10 + '0';
+	buf[pos] = dir;
 
 	uart_puts(console->uart, buf);
 }
@@ -193,6 +544,12 @@ void console_process(struct console *console)
 
 	ch = uart_getchar(console->uart);
 
+	// Binary RPC frame can start only on empty command line
+	if (ch == CONSOLE_RPC_STX && console->run_rpc && !console->size) {
+		console_rpc(console);
+		return;
+	}
+
 	switch (ch) {
 	case 0x1b: // Esc
 		console->is_esc_seq = true;
@@ -280,4 +637,9 @@ void console_help(struct console *console)
 		uart_printf(console->uart, "%s    - %s\n", console->cmds[i].cmd,
 			    console->cmds[i].help);
 	}
+	uart_puts(console->uart, "\nCommands can be separated by ';'\n");
+	uart_puts(console->uart, "repeat    - run commands several times: repeat <n> <cmd>[; <cmd>]\n");
+	uart_puts(console->uart, "script    - store commands (show them if no commands given): "
+				 "script [<cmd>[; <cmd>]]\n");
+	uart_puts(console->uart, "replay    - run stored commands: replay [n]\n");
 }
@@ -11,6 +11,26 @@
 
 #define ARG_STR	 0
 #define ARG_UINT 1
+#define ARG_ADDR 2 // unsigned integer wide enough to hold a pointer
+#define ARG_INT	 3 // signed integer, stored to `uint` as two's complement
+
+/* Binary RPC mode (see console_rpc() in console.c) */
+#define CONSOLE_RPC_STX	     0x02 // start of request frame and of successful reply frame
+#define CONSOLE_RPC_NAK	     0x15 // start of reply to corrupted request frame
+#define CONSOLE_RPC_SIZE     1024 // maximum size of request payload
+#define CONSOLE_RPC_ARGS_MAX 8
+
+#define CONSOLE_RPC_OK		    0
+#define CONSOLE_RPC_ERR_UNKNOWN_CMD 1
+#define CONSOLE_RPC_ERR_ARGS	    2
+#define CONSOLE_RPC_ERR_UNSUPPORTED 3
+#define CONSOLE_RPC_ERR_SKIPPED	    4
+#define CONSOLE_RPC_ERR_APP	    0x10 // first status code for application specific errors
+
+#define CONSOLE_RPC_NAK_CRC  1
+#define CONSOLE_RPC_NAK_SIZE 2
+
+#define CONSOLE_LINE_SIZE 256
 
 #define VERBOSE_LEVEL_ERROR   0
 #define VERBOSE_LEVEL_WARNING 1
@@ -52,6 +72,7 @@ struct console_cmd {
 struct console_arg {
 	char *str;
 	uint32_t uint;
+	uintptr_t addr;
 };
 
 /* uart - pointer to struct uart
@@ -59,8 +80,13 @@ struct console_arg {
  * cmds_count - count of commands
  * prompt - prompt string
  * app_name - application name that will be printed at enter on empty command line
+ * run_rpc - handler of commands received in binary RPC mode (NULL if RPC is not supported).
+ *           Handler sends reply by console_rpc_reply() or by console_rpc_reply_start() and
+ *           console_rpc_send(). If handler does not send reply, reply without payload and with
+ *           status returned by handler is sent.
  * pos - current position in `line` (must be initialized as 0)
  * line - buffer for command line (must be initialized with '\0' in line[0])
+ * script - commands stored by `script` command (must be initialized with '\0' in script[0])
  */
 struct console {
 	struct uart *uart;
@@ -71,17 +97,25 @@ struct console {
 	char *each_line_msg;
 	void (*run_cmd)(struct console *console, struct console_cmd *cmd, struct console_arg *args,
 			int argc);
+	int (*run_rpc)(struct console *console, struct console_cmd *cmd, struct console_arg *args,
+		       int argc, uint8_t *data, uint32_t data_len);
 	int pos;
 	int size;
-	char line[64];
+	char line[CONSOLE_LINE_SIZE];
+	char script[CONSOLE_LINE_SIZE]; // commands stored by `script` for `replay`
 	uint32_t esc_seq;
 	bool is_esc_seq; // if true then next input char is part of escape sequence
 	uint8_t esc_seq_pos; // how many bytes of escape sequency are received
+	uint16_t rpc_crc; // CRC16 of RPC reply
+	int rpc_status; // status of reply sent by RPC handler or -1 if handler has not replied yet
 };
 
 void console_cmd_line_clear(struct console *console);
 void console_cmd_line_restore(struct console *console);
 void console_process(struct console *console);
 void console_help(struct console *console);
+void console_rpc_reply_start(struct console *console, uint8_t status, uint16_t len);
+void console_rpc_send(struct console *console, const void *buf, uint32_t len);
+void console_rpc_reply(struct console *console, uint8_t status, const void *buf, uint16_t len);
 
 #endif
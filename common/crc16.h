@@ -0,0 +1,24 @@
+// SPDX-License-Identifier: MIT
+// Copyright 2021-2025 RnD Center "ELVEES", JSC
+
+#ifndef CRC16_H_
+#define CRC16_H_
+
+#include <stdint.h>
+
+/* CRC16-CCITT (polynomial 0x1021, initial value 0xffff) */
+static inline uint16_t crc16_init(void)
+{
+	return 0xffff;
+}
+
+static inline uint16_t crc16_update_byte(uint16_t crc, uint8_t data)
+{
+	crc ^= (uint16_t)data << 8;
+	for (int i = 0; i < 8; i++)
+		crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+
+	return crc;
+}
+
+#endif
@@ -0,0 +1,79 @@
+// SPDX-License-Identifier: MIT
+// Copyright 2025 RnD Center "ELVEES", JSC
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <delay.h>
+#include <eeprom.h>
+#include <i2c.h>
+
+/* Size of memory area that is addressed by alen bytes of memory address */
+static inline uint32_t eeprom_block_size(struct eeprom *eeprom)
+{
+	return 1 << (eeprom->alen * 8);
+}
+
+static inline uint32_t eeprom_bus_addr(struct eeprom *eeprom, uint32_t offset)
+{
+	return eeprom->addr | (offset >> (eeprom->alen * 8));
+}
+
+bool eeprom_wait_ready(struct eeprom *eeprom, uint32_t offset)
+{
+	unsigned long tick_start = get_tick_counter();
+
+	// Zero length write sends only bus and memory addresses
+	while (!i2c_write(eeprom->i2c, eeprom_bus_addr(eeprom, offset), offset, eeprom->alen, NULL,
+			  0)) {
+		if (ticks_to_us(ticks_since(tick_start)) > EEPROM_WRITE_TIMEOUT_US)
+			return false;
+	}
+
+	return true;
+}
+
+bool eeprom_write(struct eeprom *eeprom, uint32_t offset, uint8_t *buf, uint32_t size)
+{
+	while (size) {
+		uint32_t len = eeprom->page_size - offset % eeprom->page_size;
+
+		if (len > size)
+			len = size;
+
+		if (!i2c_write(eeprom->i2c, eeprom_bus_addr(eeprom, offset), offset, eeprom->alen, buf,
+			       len))
+			return false;
+
+		if (!eeprom_wait_ready(eeprom, offset))
+			return false;
+
+		buf += len;
+		offset += len;
+		size -= len;
+	}
+
+	return true;
+}
+
+bool eeprom_read(struct eeprom *eeprom, uint32_t offset, uint8_t *buf, uint32_t size)
+{
+	while (size) {
+		// Sequential read can not cross the boundary of block addressed by bus address
+		uint32_t len = eeprom_block_size(eeprom) - offset % eeprom_block_size(eeprom);
+
+		if (len > size)
+			len = size;
+
+		if (!i2c_read(eeprom->i2c, eeprom_bus_addr(eeprom, offset), offset, eeprom->alen, buf,
+			      len))
+			return false;
+
+		buf += len;
+		offset += len;
+		size -= len;
+	}
+
+	return true;
+}
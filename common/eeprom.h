@@ -0,0 +1,42 @@
+// SPDX-License-Identifier: MIT
+// Copyright 2025 RnD Center "ELVEES", JSC
+
+#ifndef EEPROM_H_
+#define EEPROM_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <i2c.h>
+
+/* Maximum time of EEPROM internal write cycle (most of devices need 5 ms) */
+#define EEPROM_WRITE_TIMEOUT_US 20000
+
+/* i2c - I2C controller
+ * addr - address of EEPROM on the bus
+ * alen - count of bytes of memory address (1 or 2). Memory address bits that do not fit into
+ *        alen bytes are placed into lower bits of bus address (as for 24C04..24C16).
+ * page_size - size of EEPROM write page (write can not cross page boundary)
+ */
+struct eeprom {
+	struct i2c *i2c;
+	uint32_t addr;
+	uint32_t alen;
+	uint32_t page_size;
+};
+
+/* Wait for the end of internal write cycle using ACK polling: EEPROM does not acknowledge its
+ * address while write cycle is in progress.
+ * Return false on timeout.
+ */
+bool eeprom_wait_ready(struct eeprom *eeprom, uint32_t offset);
+
+/* Write data to EEPROM. Data is split at page boundaries, each page write is followed by
+ * ACK polling.
+ */
+bool eeprom_write(struct eeprom *eeprom, uint32_t offset, uint8_t *buf, uint32_t size);
+
+/* Read data from EEPROM */
+bool eeprom_read(struct eeprom *eeprom, uint32_t offset, uint8_t *buf, uint32_t size);
+
+#endif
@@ -10,6 +10,7 @@
 #define I2C_CON_MASTER_MODE	 BIT(0)
 #define I2C_CON_SPEED_MASK_STD	 BIT(1)
 #define I2C_CON_SPEED_MASK_FAST	 BIT(2)
+#define I2C_CON_SPEED_MASK_HIGH	 (BIT(1) | BIT(2))
 #define I2C_CON_10BITADDR_SLAVE	 BIT(3)
 #define I2C_CON_10BITADDR_MASTER BIT(4)
 #define I2C_CON_RESTART_EN	 BIT(5)
@@ -20,6 +21,7 @@
 #define I2C_CMD_READ  BIT(8)
 #define I2C_CMD_WRITE ~BIT(8)
 #define I2C_CMD_STOP  BIT(9)
+#define I2C_CMD_RESTART BIT(10)
 
 #define I2C_ENABLE_ENABLE BIT(0)
 #define I2C_ENABLE_ABORT  BIT(1)
@@ -30,25 +32,155 @@
 #define I2C_STATUS_RX_NOT_EMPTY BIT(3)
 #define I2C_STATUS_MST_ACTIVITY BIT(5)
 
-void i2c_init(struct i2c *i2c, uint32_t speed, uint32_t i2c_input_clk)
+#define I2C_COMP_PARAM_1_MAX_SPEED_MODE GENMASK(3, 2)
+#define I2C_MAX_SPEED_MODE_FAST		2
+#define I2C_MAX_SPEED_MODE_HIGH		3
+
+#define I2C_HS_MASTER_CODE 1
+
+/* Bus timing parameters from I2C specification (all times are in ns).
+ * high, low - minimal SCL high and low periods
+ * rise, fall - maximal SCL rise and fall times
+ * hold - SDA hold time after SCL falling edge
+ * spike - maximal width of spikes that must be suppressed
+ */
+struct i2c_timing {
+	uint32_t speed;
+	uint32_t high;
+	uint32_t low;
+	uint32_t rise;
+	uint32_t fall;
+	uint32_t hold;
+	uint32_t spike;
+};
+
+static const struct i2c_timing i2c_timings[] = {
+	{ I2C_STANDARD_SPEED, 4000, 4700, 1000, 300, 300, 50 },
+	{ I2C_FAST_SPEED, 600, 1300, 300, 300, 300, 50 },
+	{ I2C_FAST_PLUS_SPEED, 260, 500, 120, 120, 120, 50 },
+	{ I2C_HIGH_SPEED, 60, 160, 40, 40, 10, 10 },
+};
+
+static uint32_t ns_to_clk(uint32_t ns, uint32_t clk_khz)
+{
+	return DIV_ROUND_UP(ns * clk_khz, 1000000);
+}
+
+/* Calculate SCL high and low counts for the requested speed.
+ * Controller holds SCL high for (HCNT + SPKLEN + 7) clocks after SCL is sensed high and
+ * low for (LCNT + 1) clocks, so the period also includes SCL rise time. Counts are not less
+ * than required by specification, extra clocks are distributed in proportion to the minimal
+ * high and low periods.
+ * Return achieved speed in Hz.
+ */
+static uint32_t i2c_calc_scl(const struct i2c_timing *t, uint32_t speed, uint32_t clk,
+			     uint32_t spklen, uint32_t *hcnt, uint32_t *lcnt)
+{
+	uint32_t clk_khz = clk / 1000;
+	uint32_t rise = ns_to_clk(t->rise, clk_khz);
+	uint32_t high = ns_to_clk(t->high, clk_khz);
+	uint32_t low = ns_to_clk(t->low + t->fall, clk_khz);
+	uint32_t period = DIV_ROUND_UP(clk, speed);
+
+	if (high < spklen + 7 + 6)
+		high = spklen + 7 + 6;
+
+	if (low < 8 + 1)
+		low = 8 + 1;
+
+	if (period > high + low + rise) {
+		uint32_t extra = period - high - low - rise;
+		uint32_t extra_low = extra * low / (high + low);
+
+		low += extra_low;
+		high += extra - extra_low;
+	}
+
+	*hcnt = high - spklen - 7;
+	*lcnt = low - 1;
+	if (*hcnt > 0xffff)
+		*hcnt = 0xffff;
+
+	if (*lcnt > 0xffff)
+		*lcnt = 0xffff;
+
+	return clk / (*hcnt + spklen + 7 + *lcnt + 1 + rise);
+}
+
+uint32_t i2c_init(struct i2c *i2c, uint32_t speed, uint32_t i2c_input_clk)
 {
+	const struct i2c_timing *t = &i2c_timings[0];
+	uint32_t clk_khz = i2c_input_clk / 1000;
+	uint32_t max_mode = FIELD_GET(I2C_COMP_PARAM_1_MAX_SPEED_MODE, i2c->COMP_PARAM_1);
 	uint32_t con_val = 0;
-	uint32_t scl_val = i2c_input_clk / speed / 2;
+	uint32_t spklen;
+	uint32_t hcnt, lcnt;
+	uint32_t hold;
+	uint32_t achieved;
+
+	// COMP_PARAM_1 reads as 0 if controller is built without encoded parameters
+	if (!max_mode)
+		max_mode = I2C_MAX_SPEED_MODE_FAST;
+
+	if (!speed)
+		speed = I2C_STANDARD_SPEED;
+	else if (speed > I2C_FAST_PLUS_SPEED && max_mode < I2C_MAX_SPEED_MODE_HIGH)
+		speed = I2C_FAST_PLUS_SPEED;
+	else if (speed > I2C_HIGH_SPEED)
+		speed = I2C_HIGH_SPEED;
+
+	for (int i = 0; i < ARRAY_LENGTH(i2c_timings) - 1 && speed > i2c_timings[i].speed; i++)
+		t = &i2c_timings[i + 1];
 
 	i2c->ENABLE = 0x0;
 
 	con_val = I2C_CON_SLAVE_DISABLE | I2C_CON_RESTART_EN | I2C_CON_MASTER_MODE;
-	if (speed == I2C_STANDARD_SPEED) {
+	spklen = ns_to_clk(50, clk_khz);
+	if (!spklen)
+		spklen = 1;
+
+	i2c->FS_SPKLEN = spklen;
+	if (t->speed == I2C_STANDARD_SPEED) {
 		con_val |= I2C_CON_SPEED_MASK_STD;
-		i2c->SS_SCL_HCNT = scl_val;
-		i2c->SS_SCL_LCNT = scl_val;
-	} else if (speed == I2C_FAST_SPEED) {
+		achieved = i2c_calc_scl(t, speed, i2c_input_clk, spklen, &hcnt, &lcnt);
+		i2c->SS_SCL_HCNT = hcnt;
+		i2c->SS_SCL_LCNT = lcnt;
+	} else if (t->speed != I2C_HIGH_SPEED) {
 		con_val |= I2C_CON_SPEED_MASK_FAST;
-		i2c->FS_SCL_HCNT = scl_val;
-		i2c->FS_SCL_LCNT = scl_val;
+		achieved = i2c_calc_scl(t, speed, i2c_input_clk, spklen, &hcnt, &lcnt);
+		i2c->FS_SCL_HCNT = hcnt;
+		i2c->FS_SCL_LCNT = lcnt;
+	} else {
+		// Master code is sent in fast mode before switching to high speed mode
+		con_val |= I2C_CON_SPEED_MASK_HIGH;
+		i2c_calc_scl(&i2c_timings[1], I2C_FAST_SPEED, i2c_input_clk, spklen, &hcnt,
+			     &lcnt);
+		i2c->FS_SCL_HCNT = hcnt;
+		i2c->FS_SCL_LCNT = lcnt;
+		spklen = ns_to_clk(t->spike, clk_khz);
+		if (!spklen)
+			spklen = 1;
+
+		i2c->HS_SPKLEN = spklen;
+		achieved = i2c_calc_scl(t, speed, i2c_input_clk, spklen, &hcnt, &lcnt);
+		i2c->HS_SCL_HCNT = hcnt;
+		i2c->HS_SCL_LCNT = lcnt;
+		i2c->HS_MADDR = I2C_HS_MASTER_CODE;
 	}
+
+	// SDA hold time must be less than SCL low period
+	hold = ns_to_clk(t->hold, clk_khz);
+	if (hold > lcnt - 2)
+		hold = lcnt - 2;
+
+	if (!hold)
+		hold = 1;
+
+	i2c->SDA_HOLD = (i2c->SDA_HOLD & ~GENMASK(15, 0)) | hold;
 	i2c->CON = con_val;
 	i2c->INTR_MASK = I2C_INTR_MASK_STOP_DET;
+
+	return achieved;
 }
 
 void i2c_pads_cfg(uint32_t i2c_num)
@@ -83,7 +215,11 @@ bool i2c_write(struct i2c *i2c, uint32_t addr, uint32_t regaddr, uint32_t alen,
 
 	while (alen) {
 		alen--;
-		i2c->DATA_CMD = (regaddr >> (alen * 8)) & 0xFF;
+		// Without data STOP must be issued after the last byte of register address
+		if (!alen && !size)
+			i2c->DATA_CMD = (regaddr & 0xFF) | I2C_CMD_STOP;
+		else
+			i2c->DATA_CMD = (regaddr >> (alen * 8)) & 0xFF;
 	}
 
 	for (uint32_t i = 0; i < size; i++) {
@@ -155,3 +291,123 @@ bool i2c_read(struct i2c *i2c, uint32_t addr, uint32_t regaddr, uint32_t alen, u
 
 	return ret;
 }
+
+/* Run steps chained by repeated start as one transaction */
+static bool i2c_transfer_chain(struct i2c *i2c, struct i2c_step *steps, int count)
+{
+	unsigned long tick_start = get_tick_counter();
+	int tx_step = 0;
+	int rx_step = 0;
+	uint32_t tx_pos = 0;
+	uint32_t rx_pos = 0;
+	bool ret = true;
+
+	while (rx_step < count && steps[rx_step].type != I2C_STEP_READ)
+		rx_step++;
+
+	while (tx_step < count || rx_step < count) {
+		if (tx_step < count && (i2c->STATUS & I2C_STATUS_TX_NOT_FULL)) {
+			struct i2c_step *step = &steps[tx_step];
+			uint32_t cmd = step->type == I2C_STEP_READ ? I2C_CMD_READ : step->buf[tx_pos];
+
+			if (!tx_pos && tx_step)
+				cmd |= I2C_CMD_RESTART;
+
+			if (tx_step == count - 1 && tx_pos == step->len - 1)
+				cmd |= I2C_CMD_STOP;
+
+			i2c->DATA_CMD = cmd;
+			if (++tx_pos == step->len) {
+				tx_step++;
+				tx_pos = 0;
+			}
+			tick_start = get_tick_counter();
+		}
+		if (rx_step < count && (i2c->STATUS & I2C_STATUS_RX_NOT_EMPTY)) {
+			steps[rx_step].buf[rx_pos] = i2c->DATA_CMD & 0xFF;
+			if (++rx_pos == steps[rx_step].len) {
+				rx_pos = 0;
+				do {
+					rx_step++;
+				} while (rx_step < count && steps[rx_step].type != I2C_STEP_READ);
+			}
+			tick_start = get_tick_counter();
+		}
+		if (i2c->RAW_INTR_STAT & RAW_INTR_STAT_TX_ABRT) {
+			ret = false;
+			break;
+		}
+		if (ticks_to_us(ticks_since(tick_start)) > 10000) {
+			i2c->ENABLE |= I2C_ENABLE_ABORT;
+			ret = false;
+			break;
+		}
+	}
+
+	if (ret)
+		ret = i2c_status_wait(i2c, I2C_STATUS_TX_EMPTY, I2C_STATUS_TX_EMPTY);
+
+	ret = i2c_status_wait(i2c, I2C_STATUS_MST_ACTIVITY, 0) & ret;
+	if (i2c->RAW_INTR_STAT & RAW_INTR_STAT_TX_ABRT) {
+		ret = false;
+		(void)i2c->CLR_TX_ABRT;
+	}
+
+	// Drop data that could be left after abort
+	while (i2c->STATUS & I2C_STATUS_RX_NOT_EMPTY)
+		(void)i2c->DATA_CMD;
+
+	return ret;
+}
+
+int i2c_transfer_steps(struct i2c *i2c, struct i2c_step *steps, int count)
+{
+	uint32_t addr = 0;
+	bool is_enabled = false;
+	int failed = 0;
+
+	for (int i = 0; i < count;) {
+		int n = 1;
+		bool ok = true;
+
+		if (steps[i].type == I2C_STEP_DELAY) {
+			udelay(steps[i].len);
+			steps[i].ok = true;
+			i++;
+			continue;
+		}
+
+		while (i + n < count && (steps[i + n - 1].flags & I2C_STEP_FLAG_RESTART) &&
+		       steps[i + n].type != I2C_STEP_DELAY && steps[i + n].addr == steps[i].addr)
+			n++;
+
+		for (int j = i; j < i + n; j++) {
+			if (!steps[j].len || steps[j].type > I2C_STEP_READ)
+				ok = false;
+		}
+
+		if (ok && (!is_enabled || addr != steps[i].addr)) {
+			// Target address can be changed only while controller is disabled
+			i2c->ENABLE = 0;
+			addr = steps[i].addr;
+			i2c->TAR = addr;
+			i2c->ENABLE = I2C_ENABLE_ENABLE;
+			is_enabled = true;
+		}
+
+		if (ok)
+			ok = i2c_transfer_chain(i2c, &steps[i], n);
+
+		for (int j = i; j < i + n; j++)
+			steps[j].ok = ok;
+
+		if (!ok)
+			failed += n;
+
+		i += n;
+	}
+
+	i2c->ENABLE = 0;
+
+	return failed;
+}
@@ -5,6 +5,7 @@
 #define _I2C_H
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 #include <regs.h>
@@ -73,21 +74,61 @@ struct i2c {
 	volatile uint32_t CLR_SMBUS_INTR;
 	volatile uint32_t OPTIONAL_SAR;
 	volatile uint32_t SMBUS_UDID_LSB;
+	volatile uint32_t SMBUS_UDID_WORD1;
+	volatile uint32_t SMBUS_UDID_WORD2;
+	volatile uint32_t SMBUS_UDID_WORD3;
 	volatile uint32_t RESERVED;
+	volatile uint32_t REG_TIMEOUT_RST;
 	volatile uint32_t COMP_PARAM_1;
 	volatile uint32_t COMP_VERSION;
 	volatile uint32_t COMP_TYPE;
 };
 
+_Static_assert(offsetof(struct i2c, COMP_PARAM_1) == 0xf4, "Wrong offset of COMP_PARAM_1");
+
 /* Register bits */
 #define RAW_INTR_STAT_TX_ABRT BIT(6)
 
 /* CONFIGS */
-#define I2C_STANDARD_SPEED 100000
-#define I2C_FAST_SPEED	   400000
+#define I2C_STANDARD_SPEED  100000
+#define I2C_FAST_SPEED	    400000
+#define I2C_FAST_PLUS_SPEED 1000000
+#define I2C_HIGH_SPEED	    3400000
+
+/* Types of steps for i2c_transfer_steps() */
+#define I2C_STEP_WRITE 0
+#define I2C_STEP_READ  1
+#define I2C_STEP_DELAY 2
 
-/* Initialize I2C controller */
-void i2c_init(struct i2c *i2c, uint32_t speed, uint32_t i2c_input_clk);
+/* Step is followed by repeated start instead of STOP. Next step must use the same address. */
+#define I2C_STEP_FLAG_RESTART BIT(0)
+
+/* type - I2C_STEP_*
+ * flags - I2C_STEP_FLAG_*
+ * addr - address of device on the bus
+ * len - size of data to write or read, delay in microseconds for I2C_STEP_DELAY
+ * buf - data to write or buffer for read data
+ * ok - will be set to true if step is done successfully
+ */
+struct i2c_step {
+	uint8_t type;
+	uint8_t flags;
+	uint16_t addr;
+	uint32_t len;
+	uint8_t *buf;
+	bool ok;
+};
+
+/* Initialize I2C controller
+ * speed - SCL frequency in Hz. Mode (standard, fast, fast plus or high speed) is selected by
+ *         speed. High speed mode is used only if controller supports it, otherwise speed is
+ *         limited to I2C_FAST_PLUS_SPEED.
+ * i2c_input_clk - frequency of controller clock in Hz
+ * SCL high/low counts, spike suppression and SDA hold time are calculated from bus timing
+ * parameters of I2C specification.
+ * Return achieved SCL frequency in Hz (not greater than requested one).
+ */
+uint32_t i2c_init(struct i2c *i2c, uint32_t speed, uint32_t i2c_input_clk);
 
 /* Setup pads, that used by I2C controller */
 void i2c_pads_cfg(uint32_t i2c_num);
@@ -109,4 +150,12 @@ bool i2c_read(struct i2c *i2c, uint32_t addr, uint32_t regaddr, uint32_t alen, u
 bool i2c_write(struct i2c *i2c, uint32_t addr, uint32_t regaddr, uint32_t alen, uint8_t *buf,
 	       uint32_t size);
 
+/* Run list of steps as one session. Controller is enabled once and is reconfigured only when
+ * device address changes. Steps chained by I2C_STEP_FLAG_RESTART are done as one transaction
+ * with repeated start between steps (for example, write register address and read data), such
+ * steps succeed or fail together. Failed step does not stop the session.
+ * Return count of failed steps.
+ */
+int i2c_transfer_steps(struct i2c *i2c, struct i2c_step *steps, int count);
+
 #endif /* _I2C_H */
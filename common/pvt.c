@@ -7,6 +7,7 @@
 #include <clk.h>
 #include <console.h>
 #include <delay.h>
+#include <pvt.h>
 #include <regs.h>
 #include <uart.h>
 
@@ -129,8 +130,48 @@
 #define PVT_SDA_IP_DATA_DONE  BIT(18)
 #define PVT_SDA_IP_DATA_CH    GENMASK(23, 20)
 
+#define PVT_SMPL_HILO_LO GENMASK(15, 0)
+#define PVT_SMPL_HILO_HI GENMASK(31, 16)
+
+/* Alarm A fires when a sample rises to ALARM_THRESH and is released when it falls below
+ * HYST_THRESH. Alarm B is the mirrored one for low limits. Both alarms of a channel are reported
+ * in its ALARM_IRQ register.
+ */
+#define PVT_ALARM_CFG_HYST_THRESH GENMASK(15, 0)
+#define PVT_ALARM_CFG_THRESH	  GENMASK(31, 16)
+
+#define PVT_ALARM_IRQ_A BIT(0)
+#define PVT_ALARM_IRQ_B BIT(1)
+
+#define PVT_TS_RAW_MAX 4095
+#define PVT_VM_RAW_MAX 0xffff
+
+#define PVT_ALARM_CHANNELS 16
+#define PVT_EVENTS_MAX	   16
+
 DECLARE_VERBOSE_FUNCTIONS(pvt)
 
+static uint32_t nts; // temperature sensors count
+static uint32_t nvm; // voltage monitors count
+
+/* Continuous mode state. Bit N of ready mask is set once channel N has completed its first
+ * conversion, so a stale DATA register is never reported as a sample.
+ */
+static bool cont_running;
+static uint32_t ts_ready;
+static uint32_t vm_ready;
+static uint32_t ts_ctr_base;
+static uint32_t vm_ctr_base;
+
+// Alarms armed per channel (PVT_ALARM_IRQ_A/B) and alarms that are currently raised
+static uint8_t alarm_armed[2][PVT_ALARM_CHANNELS];
+static uint8_t alarm_active[2][PVT_ALARM_CHANNELS];
+
+static struct pvt_event events[PVT_EVENTS_MAX];
+static uint32_t events_head;
+static uint32_t events_count;
+static uint32_t events_lost;
+
 static void pvt_write_ts(uint32_t addr, uint32_t value)
 {
 	uint32_t tmp;
@@ -192,9 +233,204 @@ static uint32_t pvt_read_vm(uint32_t addr, uint32_t channel)
 	return value;
 }
 
+static int32_t pvt_ts_to_mcelsius(uint32_t val)
+{
+	return (int32_t)(val * 237500 / 4094) - 81100;
+}
+
+static uint32_t pvt_vm_to_mv(uint32_t val)
+{
+	return (val + 1) * 1224 / 256;
+}
+
+static uint32_t pvt_ts_to_raw(int32_t mcelsius)
+{
+	if (mcelsius <= -81100)
+		return 0;
+
+	if (mcelsius >= pvt_ts_to_mcelsius(PVT_TS_RAW_MAX))
+		return PVT_TS_RAW_MAX;
+
+	return (mcelsius + 81100) * 4094 / 237500;
+}
+
+static uint32_t pvt_alarm_channels(enum pvt_sensor sensor)
+{
+	uint32_t count = sensor == PVT_TS ? nts : nvm;
+
+	return count > PVT_ALARM_CHANNELS ? PVT_ALARM_CHANNELS : count;
+}
+
+static uint32_t pvt_vm_to_raw(int32_t mv)
+{
+	if (mv <= (int32_t)pvt_vm_to_mv(0))
+		return 0;
+
+	if (mv >= (int32_t)pvt_vm_to_mv(PVT_VM_RAW_MAX))
+		return PVT_VM_RAW_MAX;
+
+	return mv * 256 / 1224 - 1;
+}
+
+uint32_t pvt_ts_count(void)
+{
+	return nts;
+}
+
+uint32_t pvt_vm_count(void)
+{
+	return nvm;
+}
+
+// SMPL_CTR is free-running, so counts are reported relative to the last pvt_reset_minmax()
+uint32_t pvt_ts_samples(void)
+{
+	return REG(PVT_TS_SMPL_CTR) - ts_ctr_base;
+}
+
+uint32_t pvt_vm_samples(void)
+{
+	return REG(PVT_VM_SMPL_CTR) - vm_ctr_base;
+}
+
+void pvt_reset_minmax(void)
+{
+	uint32_t i;
+
+	if (nts) {
+		REG(PVT_TS_SMPL_HI_CLR) = GENMASK(nts - 1, 0);
+		REG(PVT_TS_SMPL_LO_SET) = GENMASK(nts - 1, 0);
+	}
+
+	for (i = 0; i < nvm; i++) {
+		REG(PVT_VM_SMPL_HI_CLR(i)) = BIT(0);
+		REG(PVT_VM_SMPL_LO_SET(i)) = BIT(0);
+	}
+
+	ts_ctr_base = REG(PVT_TS_SMPL_CTR);
+	vm_ctr_base = REG(PVT_VM_SMPL_CTR);
+}
+
+void pvt_cont_start(void)
+{
+	uint32_t i;
+
+	ts_ready = 0;
+	vm_ready = 0;
+	pvt_write_ts(PVT_SDA_IP_CTRL, PVT_SDA_IP_CTRL_RUN_CONT | PVT_SDA_IP_CTRL_AUTO);
+	pvt_write_vm(PVT_SDA_IP_CTRL, PVT_SDA_IP_CTRL_RESETN | PVT_SDA_IP_CTRL_RUN_CONT);
+
+	// Drop samples of previous runs
+	for (i = 0; i < nts; i++)
+		REG(PVT_TS_DATA(i));
+
+	for (i = 0; i < nvm; i++)
+		REG(PVT_VM_DATA(i));
+
+	pvt_reset_minmax();
+	cont_running = true;
+}
+
+void pvt_cont_stop(void)
+{
+	pvt_write_ts(PVT_SDA_IP_CTRL, PVT_SDA_IP_CTRL_STOP);
+	pvt_write_vm(PVT_SDA_IP_CTRL, PVT_SDA_IP_CTRL_RESETN);
+	cont_running = false;
+}
+
+bool pvt_cont_is_running(void)
+{
+	return cont_running;
+}
+
+bool pvt_ts_read_mcelsius(uint32_t channel, int32_t *mcelsius)
+{
+	uint32_t val;
+
+	if (!cont_running || channel >= nts)
+		return false;
+
+	ts_ready |= REG(PVT_TS_SMPL_STATUS);
+	if (!(ts_ready & BIT(channel)))
+		return false;
+
+	val = REG(PVT_TS_DATA(channel));
+	if (val & (PVT_SDA_IP_DATA_TYPE | PVT_SDA_IP_DATA_FAULT))
+		return false;
+
+	*mcelsius = pvt_ts_to_mcelsius(FIELD_GET(PVT_SDA_IP_DATA_DAT, val));
+
+	return true;
+}
+
+bool pvt_vm_read_mv(uint32_t channel, uint32_t *mv)
+{
+	uint32_t val;
+
+	if (!cont_running || channel >= nvm)
+		return false;
+
+	vm_ready |= REG(PVT_VM_SMPL_STATUS);
+	if (!(vm_ready & BIT(channel)))
+		return false;
+
+	val = REG(PVT_VM_DATA(channel));
+	if (val & (PVT_SDA_IP_DATA_TYPE | PVT_SDA_IP_DATA_FAULT))
+		return false;
+
+	*mv = pvt_vm_to_mv(FIELD_GET(PVT_SDA_IP_DATA_DAT, val));
+
+	return true;
+}
+
+/* SMPL_HILO holds the highest raw sample in bits [31:16] and the lowest one in bits [15:0] since
+ * the last reset by SMPL_HI_CLR/SMPL_LO_SET.
+ */
+bool pvt_ts_get_minmax(uint32_t channel, int32_t *min, int32_t *max)
+{
+	uint32_t val;
+
+	if (channel >= nts || !(ts_ready & BIT(channel)))
+		return false;
+
+	val = REG(PVT_TS_SMPL_HILO(channel));
+	*min = pvt_ts_to_mcelsius(FIELD_GET(PVT_SMPL_HILO_LO, val));
+	*max = pvt_ts_to_mcelsius(FIELD_GET(PVT_SMPL_HILO_HI, val));
+
+	return true;
+}
+
+bool pvt_vm_get_minmax(uint32_t channel, uint32_t *min, uint32_t *max)
+{
+	uint32_t val;
+
+	if (channel >= nvm || !(vm_ready & BIT(channel)))
+		return false;
+
+	val = REG(PVT_VM_SMPL_HILO(channel));
+	*min = pvt_vm_to_mv(FIELD_GET(PVT_SMPL_HILO_LO, val));
+	*max = pvt_vm_to_mv(FIELD_GET(PVT_SMPL_HILO_HI, val));
+
+	return true;
+}
+
 uint32_t pvt_ts_measure_mcelsius(uint32_t channel)
 {
 	uint32_t val;
+	int32_t mcelsius;
+
+	// RUN_ONCE would stop continuous conversions, wait for the next sample instead
+	if (cont_running) {
+		if (poll_timeout(pvt_ts_read_mcelsius(channel, &mcelsius), val, val, 10,
+				 1000000)) {
+			VERBOSE_PRINTF(VERBOSE_LEVEL_ERROR,
+				       "pvt_ts_measure_celsius: read timeout (channel: %d)\n",
+				       channel);
+			return 0;
+		}
+
+		return mcelsius;
+	}
 
 	REG(PVT_TS_DATA(channel));
 	pvt_write_ts(PVT_SDA_IP_CTRL,
@@ -219,12 +455,23 @@ uint32_t pvt_ts_measure_mcelsius(uint32_t channel)
 	VERBOSE_PRINTF(VERBOSE_LEVEL_INFO, "RAW value: %#x\n", val);
 	val &= PVT_SDA_IP_DATA_DAT;
 
-	return val * 237500 / 4094 - 81100;
+	return pvt_ts_to_mcelsius(val);
 }
 
 uint32_t pvt_vm_measure_mv(uint32_t channel)
 {
 	uint32_t val = 0; // to suppress false positive warning from clang-format
+	uint32_t mv;
+
+	if (cont_running) {
+		if (poll_timeout(pvt_vm_read_mv(channel, &mv), val, val, 10, 1000000)) {
+			VERBOSE_PRINTF(VERBOSE_LEVEL_ERROR,
+				       "pvt_vm_measure_mv: read timeout (channel: %d)\n", channel);
+			return 0;
+		}
+
+		return mv;
+	}
 
 	pvt_write_vm(PVT_SDA_IP_CTRL, PVT_SDA_IP_CTRL_RESETN | PVT_SDA_IP_CTRL_RUN_CONT);
 
@@ -247,7 +494,7 @@ uint32_t pvt_vm_measure_mv(uint32_t channel)
 
 	val &= PVT_SDA_IP_DATA_DAT;
 
-	return (val + 1) * 1224 / 256;
+	return pvt_vm_to_mv(val);
 }
 
 void pvt_vm_set_tval(bool enable)
@@ -277,8 +524,10 @@ void pvt_init(void)
 	uint32_t pvt_div;
 	uint32_t ucg_div = (REG(SERVICE_UCG + 8 * 4) >> 10) & 0xfffff;
 	unsigned long rate = clk_pll_calc_freq(REG(SERVICE_URB_PLL), XTI_FREQUENCY);
-	uint32_t nts = 0; // temperature sensors count
-	uint32_t nvm = 0; // voltage monitors count
+
+	nts = 0;
+	nvm = 0;
+	cont_running = false;
 
 	VERBOSE_PRINTF(VERBOSE_LEVEL_DEBUG, "PLL freq: %d Hz\n", rate);
 	if (!ucg_div)
@@ -334,3 +583,158 @@ void pvt_init(void)
 	pvt_write_vm(PVT_SDA_IP_CTRL, PVT_SDA_IP_CTRL_RESETN); // reset deassert
 	mdelay(1);
 }
+
+int pvt_set_alarm(enum pvt_sensor sensor, uint32_t channel, enum pvt_alarm alarm, int32_t value,
+		  uint32_t hyst)
+{
+	uint32_t irq = alarm == PVT_ALARM_HIGH ? PVT_ALARM_IRQ_A : PVT_ALARM_IRQ_B;
+	int32_t release = alarm == PVT_ALARM_HIGH ? value - (int32_t)hyst : value + (int32_t)hyst;
+	uint32_t cfg;
+
+	if (channel >= pvt_alarm_channels(sensor))
+		return -1;
+
+	if (sensor == PVT_TS)
+		cfg = FIELD_PREP(PVT_ALARM_CFG_THRESH, pvt_ts_to_raw(value)) |
+		      FIELD_PREP(PVT_ALARM_CFG_HYST_THRESH, pvt_ts_to_raw(release));
+	else
+		cfg = FIELD_PREP(PVT_ALARM_CFG_THRESH, pvt_vm_to_raw(value)) |
+		      FIELD_PREP(PVT_ALARM_CFG_HYST_THRESH, pvt_vm_to_raw(release));
+
+	if (sensor == PVT_TS && alarm == PVT_ALARM_HIGH)
+		REG(PVT_TS_ALARMA_CFG(channel)) = cfg;
+	else if (sensor == PVT_TS)
+		REG(PVT_TS_ALARMB_CFG(channel)) = cfg;
+	else if (alarm == PVT_ALARM_HIGH)
+		REG(PVT_VM_ALARMA_CFG(channel)) = cfg;
+	else
+		REG(PVT_VM_ALARMB_CFG(channel)) = cfg;
+
+	VERBOSE_PRINTF(VERBOSE_LEVEL_DEBUG, "%s alarm %c [%d] cfg = %#x\n",
+		       sensor == PVT_TS ? "TS" : "VM", alarm == PVT_ALARM_HIGH ? 'A' : 'B', channel,
+		       cfg);
+
+	alarm_armed[sensor][channel] |= irq;
+	alarm_active[sensor][channel] &= ~irq;
+	if (sensor == PVT_TS) {
+		REG(PVT_TS_ALARM_IRQ(channel)) = irq;
+		REG(PVT_TS_ALARM_IRQ_ENA(channel)) = alarm_armed[sensor][channel];
+	} else {
+		REG(PVT_VM_ALARM_IRQ(channel)) = irq;
+		REG(PVT_VM_ALARM_IRQ_ENA(channel)) = alarm_armed[sensor][channel];
+	}
+
+	return 0;
+}
+
+void pvt_disable_alarm(enum pvt_sensor sensor, uint32_t channel, enum pvt_alarm alarm)
+{
+	uint32_t irq = alarm == PVT_ALARM_HIGH ? PVT_ALARM_IRQ_A : PVT_ALARM_IRQ_B;
+
+	if (channel >= pvt_alarm_channels(sensor))
+		return;
+
+	alarm_armed[sensor][channel] &= ~irq;
+	alarm_active[sensor][channel] &= ~irq;
+	if (sensor == PVT_TS) {
+		REG(PVT_TS_ALARM_IRQ_ENA(channel)) = alarm_armed[sensor][channel];
+		REG(PVT_TS_ALARM_IRQ(channel)) = irq;
+	} else {
+		REG(PVT_VM_ALARM_IRQ_ENA(channel)) = alarm_armed[sensor][channel];
+		REG(PVT_VM_ALARM_IRQ(channel)) = irq;
+	}
+}
+
+static void pvt_push_event(enum pvt_sensor sensor, uint32_t channel, uint32_t irq, bool active)
+{
+	struct pvt_event *event;
+	uint32_t mv;
+
+	if (events_count == PVT_EVENTS_MAX) {
+		// Keep the latest events, the oldest one is overwritten
+		events_head = (events_head + 1) % PVT_EVENTS_MAX;
+		events_count--;
+		events_lost++;
+	}
+
+	event = &events[(events_head + events_count) % PVT_EVENTS_MAX];
+	events_count++;
+
+	event->tick = get_tick_counter();
+	event->sensor = sensor;
+	event->channel = channel;
+	event->alarm = irq == PVT_ALARM_IRQ_A ? PVT_ALARM_HIGH : PVT_ALARM_LOW;
+	event->active = active;
+	event->value = 0;
+	if (sensor == PVT_TS) {
+		pvt_ts_read_mcelsius(channel, &event->value);
+	} else if (pvt_vm_read_mv(channel, &mv)) {
+		event->value = mv;
+	}
+}
+
+static int pvt_poll_channels(enum pvt_sensor sensor, uint32_t pending)
+{
+	uint32_t count = pvt_alarm_channels(sensor);
+	uint32_t status, src, irq;
+	int new_events = 0;
+
+	for (uint32_t channel = 0; channel < count; channel++) {
+		if (!(pending & BIT(channel)) && !alarm_active[sensor][channel])
+			continue;
+
+		if (sensor == PVT_TS) {
+			status = REG(PVT_TS_ALARM_IRQ(channel));
+			src = REG(PVT_TS_ALARM_IRQ_SRC(channel));
+			REG(PVT_TS_ALARM_IRQ(channel)) = status;
+		} else {
+			status = REG(PVT_VM_ALARM_IRQ(channel));
+			src = REG(PVT_VM_ALARM_IRQ_SRC(channel));
+			REG(PVT_VM_ALARM_IRQ(channel)) = status;
+		}
+
+		for (irq = PVT_ALARM_IRQ_A; irq <= PVT_ALARM_IRQ_B; irq <<= 1) {
+			if (!(alarm_armed[sensor][channel] & irq))
+				continue;
+
+			if ((status & irq) && !(alarm_active[sensor][channel] & irq)) {
+				alarm_active[sensor][channel] |= irq;
+				pvt_push_event(sensor, channel, irq, true);
+				new_events++;
+			} else if (!(status & irq) && !(src & irq) &&
+				   (alarm_active[sensor][channel] & irq)) {
+				// Sample returned over the hysteresis threshold
+				alarm_active[sensor][channel] &= ~irq;
+				pvt_push_event(sensor, channel, irq, false);
+				new_events++;
+			}
+		}
+	}
+
+	return new_events;
+}
+
+int pvt_poll_events(void)
+{
+	uint32_t ts_pending = REG(PVT_TS_ALARMA_IRQ_STATUS) | REG(PVT_TS_ALARMB_IRQ_STATUS);
+	uint32_t vm_pending = REG(PVT_VM_ALARMA_IRQ_STATUS) | REG(PVT_VM_ALARMB_IRQ_STATUS);
+
+	return pvt_poll_channels(PVT_TS, ts_pending) + pvt_poll_channels(PVT_VM, vm_pending);
+}
+
+bool pvt_get_event(struct pvt_event *event)
+{
+	if (!events_count)
+		return false;
+
+	*event = events[events_head];
+	events_head = (events_head + 1) % PVT_EVENTS_MAX;
+	events_count--;
+
+	return true;
+}
+
+uint32_t pvt_events_lost(void)
+{
+	return events_lost;
+}
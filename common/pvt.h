@@ -8,8 +8,74 @@
 
 DECLARE_VERBOSE(pvt)
 
+enum pvt_sensor {
+	PVT_TS,
+	PVT_VM,
+};
+
+enum pvt_alarm {
+	PVT_ALARM_HIGH, // hardware alarm A
+	PVT_ALARM_LOW, // hardware alarm B
+};
+
+struct pvt_event {
+	unsigned long tick; // get_tick_counter() value when event was polled
+	uint8_t sensor; // enum pvt_sensor
+	uint8_t channel;
+	uint8_t alarm; // enum pvt_alarm
+	uint8_t active; // 1 - threshold is crossed, 0 - value is back behind hysteresis threshold
+	int32_t value; // latest sample in m°C or mV, 0 if there is no valid sample
+};
+
 uint32_t pvt_ts_measure_mcelsius(uint32_t channel);
 uint32_t pvt_vm_measure_mv(uint32_t channel);
 void pvt_vm_set_tval(bool enable);
 void pvt_vm_set_sel_vin(uint32_t vin);
 void pvt_init(void);
+
+uint32_t pvt_ts_count(void);
+uint32_t pvt_vm_count(void);
+
+/* Continuous mode: all TS and VM channels convert in background (RUN_CONT). While it is running
+ * pvt_ts_measure_mcelsius() and pvt_vm_measure_mv() return the latest sample instead of starting
+ * a new conversion.
+ */
+void pvt_cont_start(void);
+void pvt_cont_stop(void);
+bool pvt_cont_is_running(void);
+
+/* Non-blocking read of the latest sample of the channel. Return false if continuous mode is not
+ * running, the channel has no sample yet or the sample is faulty.
+ */
+bool pvt_ts_read_mcelsius(uint32_t channel, int32_t *mcelsius);
+bool pvt_vm_read_mv(uint32_t channel, uint32_t *mv);
+
+/* Hardware min/max of the channel since pvt_cont_start() or pvt_reset_minmax() */
+bool pvt_ts_get_minmax(uint32_t channel, int32_t *min, int32_t *max);
+bool pvt_vm_get_minmax(uint32_t channel, uint32_t *min, uint32_t *max);
+
+/* Number of conversions done since pvt_cont_start() or pvt_reset_minmax() */
+uint32_t pvt_ts_samples(void);
+uint32_t pvt_vm_samples(void);
+void pvt_reset_minmax(void);
+
+/* Alarms compare every sample of continuous mode against thresholds in hardware.
+ * value and hyst are in m°C for TS and in mV for VM. High alarm is raised when a sample reaches
+ * value and released when it drops below (value - hyst). Low alarm is mirrored.
+ * Return -1 if channel is out of range.
+ */
+int pvt_set_alarm(enum pvt_sensor sensor, uint32_t channel, enum pvt_alarm alarm, int32_t value,
+		  uint32_t hyst);
+void pvt_disable_alarm(enum pvt_sensor sensor, uint32_t channel, enum pvt_alarm alarm);
+
+/* Collect raised and released alarms into the event log. Only a few registers are read when
+ * nothing happened, so it is cheap enough to call from main loop on every iteration.
+ * Return number of new events.
+ */
+int pvt_poll_events(void);
+
+/* Pop the oldest event from the log. When the log is full the oldest events are dropped and
+ * counted by pvt_events_lost().
+ */
+bool pvt_get_event(struct pvt_event *event);
+uint32_t pvt_events_lost(void);
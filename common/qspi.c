@@ -15,6 +15,9 @@
 #define CTRL_DMA       BIT(10)
 #define CTRL_MWAIT_EN  BIT(11)
 
+/* Maximum count of bytes sent but not read from RX FIFO. It keeps RX FIFO from overflow. */
+#define QSPI_INFLIGHT_MAX 0xf0
+
 static void _qspi_select_slave(struct qspi *qspi, uint8_t ss)
 {
 	qspi->SS = BIT(ss);
@@ -37,6 +40,11 @@ void qspi_select_slave(struct qspi *qspi, uint8_t ss)
 	_qspi_select_slave(qspi, ss);
 }
 
+void qspi_deassert_ss(struct qspi *qspi)
+{
+	qspi->CTRL_AUX &= ~0x80; // deassert SS signal
+}
+
 static void qspi_stat_wait_mask(struct qspi *qspi, uint32_t mask, uint32_t value)
 {
 	while ((qspi->STAT & mask) != value) {
@@ -52,19 +60,18 @@ void qspi_xfer(struct qspi *qspi, void *tx_buf, void *rx_buf, int len, bool is_l
 
 	qspi->CTRL_AUX |= 0x80; // assert SS signal
 	while (tx_count < len) {
+		int count = QSPI_INFLIGHT_MAX - (tx_count - rx_count);
+
+		if (count > len - tx_count)
+			count = len - tx_count;
+
 		if (tx) {
-			qspi->TX_DATA = tx[tx_count];
-			tx_count++;
-		} else {
-			if (qspi->STAT & 0x4) {
-				if ((len - tx_count) > 0xf0) {
-					qspi->TX_DUMMY = 0xf0;
-					tx_count += 0xf0;
-				} else {
-					qspi->TX_DUMMY = len - tx_count;
-					tx_count += len - tx_count;
-				}
-			}
+			// Data received while transmitting is stored to rx (full-duplex transfer)
+			for (int i = 0; i < count; i++)
+				qspi->TX_DATA = tx[tx_count++];
+		} else if (count > 0 && (qspi->STAT & 0x4)) {
+			qspi->TX_DUMMY = count;
+			tx_count += count;
 		}
 
 		while ((qspi->STAT & 0x20) == 0) {
@@ -45,14 +45,20 @@ void qspi_init(struct qspi *qspi, uint8_t ss);
  */
 void qspi_select_slave(struct qspi *qspi, uint8_t ss);
 
+/* Deassert SS signal, for example to finish transaction left open by qspi_xfer() with
+ * is_last = false.
+ * qspi: QSPI registers pointer.
+ */
+void qspi_deassert_ss(struct qspi *qspi);
+
 /* Transfer data.
  * qspi: QSPI registers pointer.
  * tx_buf: pointer to data for transmit. If NULL then will be send via MOSI `len` bytes of dummy
  *         data.
  * rx_buf: pointer to data for receive. If NULL then no data for receive (all data on MISO will be
- *         ignored).
+ *         ignored). If both tx_buf and rx_buf are set then transfer is full-duplex.
  * len: length of transmit/receive data.
- * is_last:
+ * is_last: deassert SS signal after transfer.
  */
 void qspi_xfer(struct qspi *qspi, void *tx_buf, void *rx_buf, int len, bool is_last);
 
@@ -7,6 +7,7 @@
 
 #include <clk.h>
 #include <console.h>
+#include <crc16.h>
 #include <delay.h>
 #include <snps_ssi.h>
 #include <otp.h>
@@ -26,13 +27,34 @@
 #define APP_NAME \
 	"OTP Flasher (commit: '" STRINGIZE(GIT_SHA1_SHORT) "', build: '" STRINGIZE(BUILD_ID) "')"
 
+/* Command ids are also RPC ids (see README), so values are fixed: never reorder or reuse them,
+ * only append new commands to the end.
+ */
 enum cmd_ids {
-	CMD_HELP,
-	CMD_PROGRAM,
-	CMD_PROGRAM_RAW,
-	CMD_READ,
-	CMD_BIST,
-	CMD_BISR,
+	CMD_HELP = 0,
+	CMD_PROGRAM = 1,
+	CMD_PROGRAM_RAW = 2,
+	CMD_READ = 3,
+	CMD_BIST = 4,
+	CMD_BISR = 5,
+	CMD_CHECK = 6,
+	CMD_PROGRAM_IMAGE = 7,
+	CMD_VERIFY = 8,
+	CMD_BISTMAP = 9,
+	CMD_STATS = 10,
+};
+
+// Запись разреженного образа OTP: | addr | flags | value (4 байта, little-endian) | [ecc] |
+#define IMAGE_RECORD_ECC      BIT(0) // запись содержит ECC, иначе ECC рассчитывается автоматически
+#define IMAGE_RECORD_SIZE     6
+#define IMAGE_RECORD_SIZE_MAX (IMAGE_RECORD_SIZE + 1)
+#define IMAGE_SIZE_MAX	      (OTP_WORDS_COUNT * IMAGE_RECORD_SIZE_MAX)
+
+// Содержимое слова в разреженном образе
+enum image_word {
+	IMAGE_WORD_NONE,
+	IMAGE_WORD_AUTO_ECC,
+	IMAGE_WORD_ECC,
 };
 
 uint32_t buffer[OTP_WORDS_COUNT];
@@ -50,10 +72,10 @@ struct console_cmd console_cmd[] = {
 	{
 		.cmd_id = CMD_PROGRAM,
 		.cmd = "program",
-		.help = "program data to OTP memory (required binary data) : program <otp_addr>",
+		.help = "program data to OTP memory (required binary data) : program <otp_addr> [burst]",
 		.arg_min = 1,
-		.arg_max = 1,
-		.arg_types = { ARG_UINT },
+		.arg_max = 2,
+		.arg_types = { ARG_UINT, ARG_STR },
 	},
 	{
 		.cmd_id = CMD_PROGRAM_RAW,
@@ -63,13 +85,38 @@ struct console_cmd console_cmd[] = {
 		.arg_max = 3,
 		.arg_types = { ARG_UINT, ARG_UINT, ARG_UINT },
 	},
+	{
+		.cmd_id = CMD_CHECK,
+		.cmd = "check",
+		.help = "check that data can be programmed to OTP memory (required binary data) : "
+			"check <otp_addr>",
+		.arg_min = 1,
+		.arg_max = 1,
+		.arg_types = { ARG_UINT },
+	},
+	{
+		.cmd_id = CMD_PROGRAM_IMAGE,
+		.cmd = "program_image",
+		.help = "program sparse image to OTP memory (required binary data) : program_image [burst]",
+		.arg_min = 0,
+		.arg_max = 1,
+		.arg_types = { ARG_STR },
+	},
 	{
 		.cmd_id = CMD_READ,
 		.cmd = "read",
-		.help = "read OTP data: read <otp_addr> <count> [ecc_brp_flags]",
+		.help = "read OTP data: read <otp_addr> <count> [ecc_brp_flags] [text|bin]",
 		.arg_min = 2,
-		.arg_max = 3,
-		.arg_types = { ARG_UINT, ARG_UINT, ARG_UINT },
+		.arg_max = 4,
+		.arg_types = { ARG_UINT, ARG_UINT, ARG_UINT, ARG_STR },
+	},
+	{
+		.cmd_id = CMD_VERIFY,
+		.cmd = "verify",
+		.help = "check ECC of all OTP words: verify [text|bin]",
+		.arg_min = 0,
+		.arg_max = 1,
+		.arg_types = { ARG_STR },
 	},
 	{
 		.cmd_id = CMD_BIST,
@@ -87,6 +134,22 @@ struct console_cmd console_cmd[] = {
 		.arg_max = 2,
 		.arg_types = { ARG_UINT, ARG_UINT },
 	},
+	{
+		.cmd_id = CMD_BISTMAP,
+		.cmd = "bistmap",
+		.help = "find all non-clean cells or leaky bits: bistmap <otp_addr> <count> [bisr]",
+		.arg_min = 2,
+		.arg_max = 3,
+		.arg_types = { ARG_UINT, ARG_UINT, ARG_STR },
+	},
+	{
+		.cmd_id = CMD_STATS,
+		.cmd = "stats",
+		.help = "show timing of OTP programming and BIST: stats [reset]",
+		.arg_min = 0,
+		.arg_max = 1,
+		.arg_types = { ARG_STR },
+	},
 };
 
 unsigned long __stack_chk_guard;
@@ -94,18 +157,14 @@ void __stack_chk_fail(void)
 {
 }
 
-static uint16_t crc16_init(void)
+static char *bist_err_str(int ret)
 {
-	return 0xffff;
-}
-
-static uint16_t crc16_update_byte(uint16_t crc, uint8_t data)
-{
-	crc ^= (uint16_t)data << 8;
-	for (int i = 0; i < 8; i++)
-		crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+	if (ret == OTP_ERR_BUS)
+		return " (bus timeout)";
+	else if (ret == OTP_ERR_TIMEOUT)
+		return " (operation timeout)";
 
-	return crc;
+	return "";
 }
 
 static void bist(uint32_t otp_addr, uint32_t count, int is_bisr)
@@ -121,20 +180,133 @@ static void bist(uint32_t otp_addr, uint32_t count, int is_bisr)
 	ret = otp_bist(otp_addr, count, is_bisr, &err_addr);
 	if (ret)
 		uart_printf(UART0, "BIST error%s at OTP address %d\n",
-			    (ret == OTP_ERR_BUS ? " (bus timeout)" : ""), err_addr);
+			    bist_err_str(ret), err_addr);
 	else
 		uart_puts(UART0, "Ok\n");
 }
 
-static void program_data(uint32_t otp_addr)
+static char *otp_err_str(int ret)
+{
+	switch (ret) {
+	case OTP_ERR_BUS:
+		return ": Internal SBPI bus timeout";
+	case OTP_ERR_PROG_SOAK_LIMIT:
+		return ": Soak limit exceeded";
+	case OTP_ERR_PROG_COMPARE:
+		return ": Compare mismatch";
+	case OTP_ERR_PROG_CONFLICT:
+		return ": Word can not be programmed (1 -> 0 bit transition)";
+	case OTP_ERR_TIMEOUT:
+		return ": OTP operation timeout";
+	default:
+		return "";
+	}
+}
+
+static void bist_map(uint32_t otp_addr, uint32_t count, char *mode)
+{
+	uint8_t map[OTP_MAP_SIZE];
+	int ret;
+
+	if (mode && strcmp(mode, "bisr")) {
+		uart_puts(UART0, "Error: Unknown mode\n");
+		return;
+	}
+
+	if ((otp_addr + count) > OTP_WORDS_COUNT) {
+		uart_puts(UART0, "Error: Size is too large\n");
+		return;
+	}
+
+	ret = otp_bist_map(otp_addr, count, !!mode, map);
+	if (ret < 0) {
+		uart_printf(UART0, "BIST error%s\n", bist_err_str(ret));
+		return;
+	}
+
+	for (uint32_t i = 0; i < OTP_WORDS_COUNT; i++) {
+		if (map[i / 8] & BIT(i % 8))
+			uart_printf(UART0, "BIST error at OTP address %d\n", i);
+	}
+
+	uart_printf(UART0, "Failed: %d, map:", ret);
+	for (uint32_t i = 0; i < OTP_MAP_SIZE; i++)
+		uart_printf(UART0, " %02x", map[i]);
+
+	uart_putc(UART0, '\n');
+}
+
+static void print_histogram(char *name, uint32_t *hist)
+{
+	uart_printf(UART0, "%s:\n", name);
+	for (uint32_t i = 0; i < OTP_STATS_BUCKETS; i++) {
+		if (!hist[i])
+			continue;
+
+		if (i == OTP_STATS_BUCKETS - 1)
+			uart_printf(UART0, "  >= %d: %d\n", BIT(i), hist[i]);
+		else
+			uart_printf(UART0, "  %d..%d: %d\n", i ? BIT(i) : 0, BIT(i + 1) - 1, hist[i]);
+	}
+}
+
+static void stats(char *mode)
+{
+	struct otp_stats *stats = otp_get_stats();
+
+	if (mode) {
+		if (strcmp(mode, "reset")) {
+			uart_puts(UART0, "Error: Unknown mode\n");
+			return;
+		}
+		otp_reset_stats();
+		uart_puts(UART0, "Ok\n");
+		return;
+	}
+
+	if (stats->words)
+		uart_printf(UART0,
+			    "Programmed words: %d, time (us): min %d, avg %d, max %d at address %d\n",
+			    stats->words, stats->word_us_min, stats->word_us_total / stats->words,
+			    stats->word_us_max, stats->word_max_addr);
+	else
+		uart_puts(UART0, "Programmed words: 0\n");
+
+	if (stats->bist_runs)
+		uart_printf(UART0, "BIST runs: %d, time (us): avg %d, max %d, status polls: %d\n",
+			    stats->bist_runs, stats->bist_us_total / stats->bist_runs,
+			    stats->bist_us_max, stats->bist_polls);
+
+	if (stats->pmc_timeouts)
+		uart_printf(UART0, "PMC timeouts: %d\n", stats->pmc_timeouts);
+
+	if (stats->cmds)
+		uart_printf(UART0, "SBPI commands: %d, avg time (us): %d\n", stats->cmds,
+			    ticks_to_us(stats->cmd_ticks / stats->cmds));
+
+	if (stats->words) {
+		print_histogram("Word program time (us)", stats->time_hist);
+		print_histogram("Status polls per word", stats->poll_hist);
+	}
+}
+
+static bool is_burst_mode(char *mode)
+{
+	if (!mode)
+		return false;
+
+	return !strcmp(mode, "burst");
+}
+
+/* Receive block of words for OTP address otp_addr to buffer.
+ * Return count of received words or 0 on error.
+ */
+static uint32_t receive_words(uint32_t otp_addr)
 {
-	char *err = "";
 	uint16_t block_size;
 	uint16_t expected_crc;
 	uint16_t crc;
-	uint16_t err_addr = 0;
 	uint8_t *p_buf8 = (uint8_t *)buffer;
-	int ret;
 
 	block_size = uart_getchar(UART0);
 	block_size |= (uint16_t)uart_getchar(UART0) << 8;
@@ -142,13 +314,13 @@ static void program_data(uint32_t otp_addr)
 	expected_crc |= (uint16_t)uart_getchar(UART0) << 8;
 	if (!block_size) {
 		uart_puts(UART0, "E\nSize can not be zero\n");
-		return;
+		return 0;
 	} else if ((block_size % sizeof(uint32_t)) != 0) {
 		uart_puts(UART0, "E\nSize must be aligned by 32-bit word\n");
-		return;
+		return 0;
 	} else if ((otp_addr + (block_size / sizeof(uint32_t))) > OTP_WORDS_COUNT) {
 		uart_puts(UART0, "E\nSize is too large\n");
-		return;
+		return 0;
 	}
 	uart_putc(UART0, 'R');
 
@@ -160,19 +332,195 @@ static void program_data(uint32_t otp_addr)
 
 	if (crc != expected_crc) {
 		uart_printf(UART0, "E\nCorrupted data from UART (CRC %#x != %#x)\n", crc, expected_crc);
+		return 0;
+	}
+
+	return block_size / sizeof(uint32_t);
+}
+
+/* Program only words that differ from received data. Nothing is programmed if some word
+ * requires 1 -> 0 bit transition.
+ */
+static void program_data(uint32_t otp_addr, bool is_burst)
+{
+	uint16_t err_addr = 0;
+	uint32_t count;
+	int ret;
+
+	count = receive_words(otp_addr);
+	if (!count)
+		return;
+
+	ret = otp_program_diff(buffer, otp_addr, count, &err_addr, is_burst);
+	if (ret)
+		uart_printf(UART0, "E\nOTP program failed at address %d %s\n", err_addr,
+			    otp_err_str(ret));
+	else
+		uart_putc(UART0, 'R');
+}
+
+/* Compare received data with OTP content and print programming plan */
+static void check_data(uint32_t otp_addr)
+{
+	uint32_t stat[3] = { 0 };
+	uint8_t plan[OTP_WORDS_COUNT];
+	uint32_t count;
+	int ret;
+
+	count = receive_words(otp_addr);
+	if (!count)
+		return;
+
+	uart_putc(UART0, '\n');
+	ret = otp_plan(buffer, NULL, otp_addr, count, plan);
+	if (ret < 0) {
+		uart_printf(UART0, "Error: OTP read failed%s\n", otp_err_str(ret));
 		return;
 	}
 
-	ret = otp_program(buffer, NULL, otp_addr, block_size / 4, &err_addr);
-	if (ret == OTP_ERR_BUS)
-		err = ": Internal SBPI bus timeout";
-	else if (ret == OTP_ERR_PROG_SOAK_LIMIT)
-		err = ": Soak limit exceeded";
-	else if (ret == OTP_ERR_PROG_COMPARE)
-		err = ": Compare mismatch";
+	for (uint32_t i = 0; i < count; i++) {
+		stat[plan[i]]++;
+		if (plan[i] == OTP_WORD_CONFLICT)
+			uart_printf(UART0, "[%d] Conflict: target %#x can not be programmed\n",
+				    otp_addr + i, buffer[i]);
+	}
+
+	uart_printf(UART0, "Unchanged: %d, to program: %d, conflicts: %d\n",
+		    stat[OTP_WORD_UNCHANGED], stat[OTP_WORD_PROGRAM], stat[OTP_WORD_CONFLICT]);
+}
 
+/* Parse sparse image to buffer and buffer_ecc. Kind of each word (enum image_word) is stored
+ * to words. Return false if image is malformed or contains duplicate addresses.
+ */
+static bool image_parse(uint8_t *image, uint32_t len, uint8_t *words)
+{
+	uint32_t pos = 0;
+
+	for (uint32_t i = 0; i < OTP_WORDS_COUNT; i++) {
+		words[i] = IMAGE_WORD_NONE;
+		buffer[i] = 0;
+		buffer_ecc[i] = 0;
+	}
+
+	while (pos < len) {
+		uint32_t addr = image[pos];
+		uint32_t flags;
+		uint32_t size;
+
+		if (pos + IMAGE_RECORD_SIZE > len)
+			return false;
+
+		flags = image[pos + 1];
+		size = (flags & IMAGE_RECORD_ECC) ? IMAGE_RECORD_SIZE_MAX : IMAGE_RECORD_SIZE;
+		if (pos + size > len || addr >= OTP_WORDS_COUNT || (flags & ~IMAGE_RECORD_ECC) ||
+		    words[addr] != IMAGE_WORD_NONE)
+			return false;
+
+		buffer[addr] = image[pos + 2] | ((uint32_t)image[pos + 3] << 8) |
+			       ((uint32_t)image[pos + 4] << 16) | ((uint32_t)image[pos + 5] << 24);
+		if (flags & IMAGE_RECORD_ECC) {
+			buffer_ecc[addr] = image[pos + 6];
+			words[addr] = IMAGE_WORD_ECC;
+		} else {
+			buffer_ecc[addr] = otp_calculate_ecc(buffer[addr]);
+			words[addr] = IMAGE_WORD_AUTO_ECC;
+		}
+		pos += size;
+	}
+
+	return true;
+}
+
+/* Program words of parsed image in address order. Nothing is programmed if some word can not
+ * be programmed. Words with automatic ECC at consecutive addresses are programmed as one run.
+ */
+static int image_program(uint8_t *words, uint16_t *err_addr, int is_burst)
+{
+	uint8_t plan[OTP_WORDS_COUNT];
+	uint32_t start;
+	int ret;
+
+	ret = otp_plan(buffer, buffer_ecc, 0, OTP_WORDS_COUNT, plan);
+	if (ret < 0) {
+		*err_addr = 0;
+		return ret;
+	}
+
+	for (uint32_t i = 0; i < OTP_WORDS_COUNT; i++) {
+		if (words[i] == IMAGE_WORD_NONE || plan[i] != OTP_WORD_CONFLICT)
+			continue;
+
+		*err_addr = i;
+		return OTP_ERR_PROG_CONFLICT;
+	}
+
+	for (uint32_t i = 0; i < OTP_WORDS_COUNT; i++) {
+		if (words[i] == IMAGE_WORD_NONE || plan[i] != OTP_WORD_PROGRAM)
+			continue;
+
+		if (words[i] == IMAGE_WORD_ECC) {
+			*err_addr = i;
+			ret = otp_program(&buffer[i], &buffer_ecc[i], i, 1, NULL, 0);
+		} else {
+			start = i;
+			while (i + 1 < OTP_WORDS_COUNT && words[i + 1] == IMAGE_WORD_AUTO_ECC &&
+			       plan[i + 1] == OTP_WORD_PROGRAM)
+				i++;
+
+			ret = otp_program(&buffer[start], NULL, start, i - start + 1, err_addr,
+					  is_burst);
+		}
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
+/* Receive sparse image (whole image is one block with CRC16) and program it */
+static void program_image(bool is_burst)
+{
+	uint8_t image[IMAGE_SIZE_MAX];
+	uint8_t words[OTP_WORDS_COUNT];
+	uint16_t block_size;
+	uint16_t expected_crc;
+	uint16_t crc;
+	uint16_t err_addr = 0;
+	int ret;
+
+	block_size = uart_getchar(UART0);
+	block_size |= (uint16_t)uart_getchar(UART0) << 8;
+	expected_crc = uart_getchar(UART0);
+	expected_crc |= (uint16_t)uart_getchar(UART0) << 8;
+	if (!block_size) {
+		uart_puts(UART0, "E\nSize can not be zero\n");
+		return;
+	} else if (block_size > sizeof(image)) {
+		uart_puts(UART0, "E\nSize is too large\n");
+		return;
+	}
+	uart_putc(UART0, 'R');
+
+	crc = crc16_init();
+	for (unsigned i = 0; i < block_size; i++) {
+		image[i] = uart_getchar(UART0);
+		crc = crc16_update_byte(crc, image[i]);
+	}
+
+	if (crc != expected_crc) {
+		uart_printf(UART0, "E\nCorrupted data from UART (CRC %#x != %#x)\n", crc, expected_crc);
+		return;
+	}
+
+	if (!image_parse(image, block_size, words)) {
+		uart_puts(UART0, "E\nWrong image records\n");
+		return;
+	}
+
+	ret = image_program(words, &err_addr, is_burst);
 	if (ret)
-		uart_printf(UART0, "E\nOTP program failed at address %d %s\n", err_addr, err);
+		uart_printf(UART0, "E\nOTP program failed at address %d %s\n", err_addr,
+			    otp_err_str(ret));
 	else
 		uart_putc(UART0, 'R');
 }
@@ -180,7 +528,6 @@ static void program_data(uint32_t otp_addr)
 static void program_raw(uint32_t otp_addr, uint32_t value, uint32_t ecc)
 {
 	int ret;
-	char *err = "";
 
 	if (ecc > 0xff) {
 		uart_printf(UART0, "Error: ECC must be in [0..0xFF]\n");
@@ -194,22 +541,33 @@ static void program_raw(uint32_t otp_addr, uint32_t value, uint32_t ecc)
 
 	buffer[0] = value;
 	buffer_ecc[0] = ecc & 0xff;
-	ret = otp_program(buffer, buffer_ecc, otp_addr, 1, NULL);
-	if (ret == OTP_ERR_BUS)
-		err = ": Internal SBPI bus timeout";
-	else if (ret == OTP_ERR_PROG_SOAK_LIMIT)
-		err = ": Soak limit exceeded";
-	else if (ret == OTP_ERR_PROG_COMPARE)
-		err = ": Compare mismatch";
-
+	ret = otp_program(buffer, buffer_ecc, otp_addr, 1, NULL, 0);
 	if (ret)
-		uart_printf(UART0, "OTP program failed%s\n", err);
+		uart_printf(UART0, "OTP program failed%s\n", otp_err_str(ret));
 	else
 		uart_puts(UART0, "Done\n");
 }
 
-static void read_words(uint32_t idx_first, uint32_t count, uint32_t flags)
+/* Read OTP words. Text mode prints each word with ECC check result. Binary mode outputs '#',
+ * 5 bytes for each word (data in little-endian and ECC) and CRC16 of them (little-endian).
+ */
+static void read_words(uint32_t idx_first, uint32_t count, uint32_t flags, char *mode)
 {
+	uint8_t result[OTP_WORDS_COUNT];
+	uint8_t word[5];
+	uint16_t crc;
+	bool is_bin;
+	int ret;
+
+	if (!mode || !strcmp(mode, "text")) {
+		is_bin = false;
+	} else if (!strcmp(mode, "bin")) {
+		is_bin = true;
+	} else {
+		uart_puts(UART0, "Error: Unknown mode\n");
+		return;
+	}
+
 	if (idx_first >= OTP_WORDS_COUNT || (idx_first + count) > OTP_WORDS_COUNT) {
 		uart_printf(UART0, "Error: Index or count is too big\n");
 		return;
@@ -220,15 +578,100 @@ static void read_words(uint32_t idx_first, uint32_t count, uint32_t flags)
 		return;
 	}
 
-	otp_read(buffer, buffer_ecc, idx_first, count, flags);
+	ret = otp_read(buffer, buffer_ecc, idx_first, count, flags);
+	if (ret) {
+		uart_printf(UART0, "Error: OTP read failed%s\n", otp_err_str(ret));
+		return;
+	}
+
+	if (is_bin) {
+		uart_putc(UART0, '#');
+		crc = crc16_init();
+		for (uint32_t i = 0; i < count; i++) {
+			for (int j = 0; j < 4; j++)
+				word[j] = buffer[i] >> (j * 8);
+
+			word[4] = buffer_ecc[i];
+			for (uint32_t j = 0; j < sizeof(word); j++) {
+				uart_putc_raw(UART0, word[j]);
+				crc = crc16_update_byte(crc, word[j]);
+			}
+		}
+		uart_putc_raw(UART0, crc & 0xff);
+		uart_putc_raw(UART0, crc >> 8);
+		return;
+	}
+
+	otp_ecc_decode(buffer, buffer_ecc, count, result);
 	for (uint32_t i = 0; i < count; i++) {
-		uint32_t ecc = otp_calculate_ecc(buffer[i]);
-		char *ecc_check = ecc == (buffer_ecc[i] & 0x3f) ? "ok" : "error";
+		char *ecc_check = result[i] == OTP_ECC_OK ? "ok" : "error";
 		uart_printf(UART0, "[%d] Data: %#x, ECC: %#x (%s)\n", idx_first + i, buffer[i],
 			    buffer_ecc[i], ecc_check);
 	}
 }
 
+/* Check ECC of all OTP words (read without ECC correction). Text mode prints words with errors
+ * and summary. Binary mode outputs '#', result of each word (OTP_ECC_*) and CRC16 of results.
+ */
+static void verify(char *mode)
+{
+	uint8_t result[OTP_WORDS_COUNT];
+	uint32_t stat[3] = { 0 };
+	uint16_t crc;
+	bool is_bin;
+	int ret;
+
+	if (!mode || !strcmp(mode, "text")) {
+		is_bin = false;
+	} else if (!strcmp(mode, "bin")) {
+		is_bin = true;
+	} else {
+		uart_puts(UART0, "Error: Unknown mode\n");
+		return;
+	}
+
+	ret = otp_read(buffer, buffer_ecc, 0, OTP_WORDS_COUNT, OTP_FLAG_ECC_DIS);
+	if (ret) {
+		uart_printf(UART0, "Error: OTP read failed%s\n", otp_err_str(ret));
+		return;
+	}
+
+	otp_ecc_decode(buffer, buffer_ecc, OTP_WORDS_COUNT, result);
+	if (is_bin) {
+		uart_putc(UART0, '#');
+		crc = crc16_init();
+		for (uint32_t i = 0; i < OTP_WORDS_COUNT; i++) {
+			uart_putc_raw(UART0, result[i]);
+			crc = crc16_update_byte(crc, result[i]);
+		}
+		uart_putc_raw(UART0, crc & 0xff);
+		uart_putc_raw(UART0, crc >> 8);
+		return;
+	}
+
+	for (uint32_t i = 0; i < OTP_WORDS_COUNT; i++) {
+		if (result[i] == OTP_ECC_OK) {
+			stat[0]++;
+			continue;
+		}
+
+		uart_printf(UART0, "[%d] Data: %#x, ECC: %#x: ", i, buffer[i], buffer_ecc[i]);
+		if (result[i] == OTP_ECC_UNCORRECTABLE) {
+			stat[2]++;
+			uart_puts(UART0, "uncorrectable error\n");
+		} else if (result[i] & OTP_ECC_DATA_BIT) {
+			stat[1]++;
+			uart_printf(UART0, "correctable error in data bit %d\n", result[i] & 0x1f);
+		} else {
+			stat[1]++;
+			uart_printf(UART0, "correctable error in ECC bit %d\n", result[i] & 0x7);
+		}
+	}
+
+	uart_printf(UART0, "Ok: %d, correctable: %d, uncorrectable: %d\n", stat[0], stat[1],
+		    stat[2]);
+}
+
 void console_run(struct console *console, struct console_cmd *cmd, struct console_arg *args,
 		 int argc)
 {
@@ -239,15 +682,34 @@ void console_run(struct console *console, struct console_cmd *cmd, struct consol
 		console_help(console);
 		break;
 	case CMD_PROGRAM:
+		if (argc > 1 && !is_burst_mode(args[1].str)) {
+			uart_puts(UART0, "Error: Unknown mode\n");
+			break;
+		}
 		uart_puts(UART0, "Ready for data\n#");
-		program_data(args[0].uint);
+		program_data(args[0].uint, argc > 1);
 		break;
 	case CMD_PROGRAM_RAW:
 		program_raw(args[0].uint, args[1].uint, args[2].uint);
 		break;
+	case CMD_CHECK:
+		uart_puts(UART0, "Ready for data\n#");
+		check_data(args[0].uint);
+		break;
+	case CMD_PROGRAM_IMAGE:
+		if (argc > 0 && !is_burst_mode(args[0].str)) {
+			uart_puts(UART0, "Error: Unknown mode\n");
+			break;
+		}
+		uart_puts(UART0, "Ready for data\n#");
+		program_image(argc > 0);
+		break;
 	case CMD_READ:
 		flags = argc > 2 ? args[2].uint : 0;
-		read_words(args[0].uint, args[1].uint, flags);
+		read_words(args[0].uint, args[1].uint, flags, argc > 3 ? args[3].str : NULL);
+		break;
+	case CMD_VERIFY:
+		verify(argc > 0 ? args[0].str : NULL);
 		break;
 	case CMD_BIST:
 		bist(args[0].uint, args[1].uint, 0);
@@ -255,11 +717,137 @@ void console_run(struct console *console, struct console_cmd *cmd, struct consol
 	case CMD_BISR:
 		bist(args[0].uint, args[1].uint, 1);
 		break;
+	case CMD_BISTMAP:
+		bist_map(args[0].uint, args[1].uint, argc > 2 ? args[2].str : NULL);
+		break;
+	case CMD_STATS:
+		stats(argc > 0 ? args[0].str : NULL);
+		break;
 	default:
 		break;
 	}
 }
 
+/* Reply to RPC operation with OTP error code. Status is CONSOLE_RPC_ERR_APP - ret, payload is
+ * OTP address of the error (16-bit little-endian).
+ */
+static int rpc_reply_otp_error(struct console *console, int ret, uint16_t err_addr)
+{
+	uint8_t buf[2] = { err_addr & 0xff, err_addr >> 8 };
+
+	if (!ret)
+		return CONSOLE_RPC_OK;
+
+	console_rpc_reply(console, CONSOLE_RPC_ERR_APP - ret, buf, sizeof(buf));
+
+	return CONSOLE_RPC_OK;
+}
+
+/* Handler of commands received in binary RPC mode. Data for program command is taken from
+ * the RPC operation as 32-bit little-endian words.
+ */
+int console_run_rpc(struct console *console, struct console_cmd *cmd, struct console_arg *args,
+		    int argc, uint8_t *data, uint32_t data_len)
+{
+	uint32_t otp_addr = args[0].uint;
+	uint32_t count = args[1].uint;
+	uint8_t plan[OTP_WORDS_COUNT];
+	uint16_t err_addr = 0;
+	uint8_t buf[5];
+	bool is_burst;
+	int ret;
+
+	switch (cmd->cmd_id) {
+	case CMD_PROGRAM:
+	case CMD_CHECK:
+		count = data_len / sizeof(uint32_t);
+		if (!data_len || (data_len % sizeof(uint32_t)) || otp_addr >= OTP_WORDS_COUNT ||
+		    (otp_addr + count) > OTP_WORDS_COUNT)
+			return CONSOLE_RPC_ERR_ARGS;
+
+		for (uint32_t i = 0; i < count; i++)
+			buffer[i] = data[i * 4] | ((uint32_t)data[i * 4 + 1] << 8) |
+				    ((uint32_t)data[i * 4 + 2] << 16) | ((uint32_t)data[i * 4 + 3] << 24);
+
+		if (cmd->cmd_id == CMD_CHECK) {
+			ret = otp_plan(buffer, NULL, otp_addr, count, plan);
+			if (ret < 0)
+				return rpc_reply_otp_error(console, ret, otp_addr);
+
+			console_rpc_reply(console, CONSOLE_RPC_OK, plan, count);
+			return CONSOLE_RPC_OK;
+		}
+
+		if (argc > 1 && !is_burst_mode(args[1].str))
+			return CONSOLE_RPC_ERR_ARGS;
+
+		ret = otp_program_diff(buffer, otp_addr, count, &err_addr, argc > 1);
+		return rpc_reply_otp_error(console, ret, err_addr);
+	case CMD_PROGRAM_IMAGE:
+		is_burst = argc > 0;
+		if ((is_burst && !is_burst_mode(args[0].str)) || data_len > IMAGE_SIZE_MAX ||
+		    !image_parse(data, data_len, plan))
+			return CONSOLE_RPC_ERR_ARGS;
+
+		ret = image_program(plan, &err_addr, is_burst);
+		return rpc_reply_otp_error(console, ret, err_addr);
+	case CMD_PROGRAM_RAW:
+		if (args[2].uint > 0xff || otp_addr >= OTP_WORDS_COUNT)
+			return CONSOLE_RPC_ERR_ARGS;
+
+		buffer[0] = args[1].uint;
+		buffer_ecc[0] = args[2].uint;
+		ret = otp_program(buffer, buffer_ecc, otp_addr, 1, NULL, 0);
+		return rpc_reply_otp_error(console, ret, otp_addr);
+	case CMD_READ:
+		if (otp_addr >= OTP_WORDS_COUNT || (otp_addr + count) > OTP_WORDS_COUNT ||
+		    (args[2].uint & ~OTP_FLAG_MASK))
+			return CONSOLE_RPC_ERR_ARGS;
+
+		ret = otp_read(buffer, buffer_ecc, otp_addr, count, args[2].uint);
+		if (ret)
+			return rpc_reply_otp_error(console, ret, otp_addr);
+
+		console_rpc_reply_start(console, CONSOLE_RPC_OK, count * sizeof(buf));
+		for (uint32_t i = 0; i < count; i++) {
+			for (int j = 0; j < 4; j++)
+				buf[j] = buffer[i] >> (j * 8);
+
+			buf[4] = buffer_ecc[i];
+			console_rpc_send(console, buf, sizeof(buf));
+		}
+		return CONSOLE_RPC_OK;
+	case CMD_VERIFY:
+		ret = otp_read(buffer, buffer_ecc, 0, OTP_WORDS_COUNT, OTP_FLAG_ECC_DIS);
+		if (ret)
+			return rpc_reply_otp_error(console, ret, 0);
+
+		otp_ecc_decode(buffer, buffer_ecc, OTP_WORDS_COUNT, plan);
+		console_rpc_reply(console, CONSOLE_RPC_OK, plan, OTP_WORDS_COUNT);
+		return CONSOLE_RPC_OK;
+	case CMD_BIST:
+	case CMD_BISR:
+		if (otp_addr >= OTP_WORDS_COUNT || (otp_addr + count) > OTP_WORDS_COUNT)
+			return CONSOLE_RPC_ERR_ARGS;
+
+		ret = otp_bist(otp_addr, count, cmd->cmd_id == CMD_BISR, &err_addr);
+		return rpc_reply_otp_error(console, ret, err_addr);
+	case CMD_BISTMAP:
+		if (otp_addr >= OTP_WORDS_COUNT || (otp_addr + count) > OTP_WORDS_COUNT ||
+		    (argc > 2 && strcmp(args[2].str, "bisr")))
+			return CONSOLE_RPC_ERR_ARGS;
+
+		ret = otp_bist_map(otp_addr, count, argc > 2, plan);
+		if (ret < 0)
+			return rpc_reply_otp_error(console, ret, 0);
+
+		console_rpc_reply(console, CONSOLE_RPC_OK, plan, OTP_MAP_SIZE);
+		return CONSOLE_RPC_OK;
+	default:
+		return CONSOLE_RPC_ERR_UNSUPPORTED;
+	}
+}
+
 struct console console = {
 	.uart = UART0,
 	.cmds = console_cmd,
@@ -268,6 +856,7 @@ struct console console = {
 	.app_name = APP_NAME,
 	.each_line_msg = APP_NAME,
 	.run_cmd = console_run,
+	.run_rpc = console_run_rpc,
 };
 
 static uint32_t get_ucg_enabled_mask(struct ucg *ucg)
@@ -1,6 +1,9 @@
 // SPDX-License-Identifier: MIT
 // Copyright 2025 RnD Center "ELVEES", JSC
 
+#include <stdbool.h>
+
+#include <delay.h>
 #include <otp.h>
 #include <regs.h>
 
@@ -71,7 +74,14 @@
 // Инструкции DAP
 #define GQ_CMD 0x2
 
-#define TIMEOUT_OTP 10000
+// Время ожидания готовности SSI, мкс
+#define TIMEOUT_OTP_US 1000
+
+// Начальный и максимальный период опроса регистра состояния PMC и время ожидания завершения
+// команды PMC, мкс
+#define STATUS_POLL_US	   1
+#define STATUS_POLL_MAX_US 64
+#define PMC_TIMEOUT_US	   200000
 
 #define GET_SERVICE_SUBS_URB_OTP_FLAG_BOOT_DONE(x) ((x) & (1 << 1))
 #define GET_SERVICE_SUBS_URB_OTP_FLAG_FLAG(x)	   ((x) & (1 << 0))
@@ -267,8 +277,32 @@ union pmc_regs {
 	uint8_t bytes[16];
 };
 
+// Количество копий содержимого OTP для разных флагов ECC/BRP
+#define SHADOW_SLOTS 4
+
 SNPS_SSI_regs_t *SSI;
 
+// Копии содержимого OTP в ОЗУ. Чтение выполняется из копии, считанной с теми же флагами ECC/BRP.
+// Копии сбрасываются при программировании OTP и при BISR.
+static struct {
+	uint32_t data[OTP_WORDS_COUNT];
+	uint8_t ecc[OTP_WORDS_COUNT];
+	uint8_t flags;
+	bool valid;
+} otp_shadow[SHADOW_SLOTS];
+static uint32_t otp_shadow_next;
+
+static struct otp_stats otp_stats = { .word_us_min = UINT32_MAX };
+
+// Формат кадров, на который настроен SSI. Последовательные кадры одного формата передаются без
+// перенастройки контроллера.
+static struct {
+	uint32_t spi_ctrlr0;
+	uint32_t tmod;
+	uint32_t ctrlr1;
+	bool valid;
+} ssi_format;
+
 /**
  * @brief Функция первоначальной настройки SSI
  * @details Функция
@@ -346,71 +380,95 @@ void SBPI_initMaster(SNPS_SSI_regs_t *_SSI)
 	};
 
 	SSI = _SSI;
+	ssi_format.valid = false;
 	SNPS_SSI_setDwParams(&params);
 	SBPI_configureMaster();
 	SSI->SPI_CTRLR0 = INST_L_8bit | ADDR_L_0bit | TRANS_TYPE_10;
 }
 
+/**
+ * @brief Настройка формата кадров SSI
+ * @details Контроллер отключается и перенастраивается только если формат отличается от текущего.
+ * Перед вызовом контроллер должен завершить передачу.
+ * @param spi_ctrlr0 значение регистра SPI_CTRLR0
+ * @param tmod режим передачи
+ * @param ctrlr1 количество принимаемых кадров минус 1
+ */
+static void setFrameFormat(uint32_t spi_ctrlr0, uint32_t tmod, uint32_t ctrlr1)
+{
+	if (ssi_format.valid && ssi_format.spi_ctrlr0 == spi_ctrlr0 && ssi_format.tmod == tmod &&
+	    ssi_format.ctrlr1 == ctrlr1)
+		return;
+
+	SNPS_SSI_disableSsi(SSI);
+	SSI->SPI_CTRLR0 = spi_ctrlr0;
+	SNPS_SSI_setTransferMode(SSI, tmod);
+	SSI->CTRLR1 = ctrlr1;
+	SNPS_SSI_enableSsi(SSI);
+	ssi_format.spi_ctrlr0 = spi_ctrlr0;
+	ssi_format.tmod = tmod;
+	ssi_format.ctrlr1 = ctrlr1;
+	ssi_format.valid = true;
+}
+
+/**
+ * @brief Ожидание состояния SSI
+ * @details Ожидание, пока биты mask регистра SR не станут равными value. Время ожидания
+ * отсчитывается по счетчику тиков и не зависит от частоты процессора.
+ * @param mask маска проверяемых битов регистра SR
+ * @param value ожидаемое значение битов
+ * @param timeout_us время ожидания в микросекундах
+ * @return 0 - Ok, 1 - истекло время ожидания
+ */
+static int ssiWait(uint32_t mask, uint32_t value, uint32_t timeout_us)
+{
+	// Обычно SSI уже в нужном состоянии, счетчик тиков не читается
+	if ((SSI->SR & mask) == value)
+		return 0;
+
+	return poll_read32_mask_timeout((uintptr_t)&SSI->SR, mask, value, timeout_us) ? 1 : 0;
+}
+
 /**
  * @brief Функция считывания данных из PVT, IPS, DAP,
  * @param ser выбор сигнала slave select
  * @param cmd  код команды
  * @param buff указатель на область памяти куда будут складываться считанные данные
  * @param size размер выделенной памяти
- * @param timeout время ожидания завершения операции
- * @return
+ * @param timeout время ожидания завершения операции в микросекундах
+ * @return 0 - Ok, 1 - истекло время ожидания
  */
 static uint32_t readData(uint8_t ser, uint8_t cmd, uint8_t *buff, unsigned long size,
 			 uint32_t timeout)
 {
-	unsigned tmp1;
-	uint32_t sr;
-
 	// ожидание завершения передачи
-	tmp1 = timeout;
-	while ((SSI->SR & BUSY)) {
-		if (!tmp1--) {
-			return 1;
-		}
-	}
-	// отключение контроллера и перенастройка
-	// настройка формата данных
-	SNPS_SSI_disableSsi(SSI);
-	SSI->SPI_CTRLR0 = INST_L_8bit | ADDR_L_0bit | TRANS_TYPE_10;
-	SNPS_SSI_setTransferMode(SSI, RX_ONLY);
-	// установка количества байт на считывание
-	SSI->CTRLR1 = size;
-	SNPS_SSI_enableSsi(SSI);
+	if (ssiWait(BUSY, 0, timeout))
+		return 1;
+
+	// настройка формата данных и количества байт на считывание
+	setFrameFormat(INST_L_8bit | ADDR_L_0bit | TRANS_TYPE_10, RX_ONLY, size);
 	SSI->SER = ser;
 	uint32_t i;
 	for (i = 0; i < size + 1; i++) {
-		tmp1 = timeout;
 		// проверка: FIFO не полный
-		do {
-			sr = SSI->SR;
-			if (!tmp1--) {
-				return 1;
-			}
-		} while (!(sr & TFNF));
+		if (ssiWait(TFNF, TFNF, timeout))
+			return 1;
+
 		// запись данных в буфер
 		if (i == 0) {
 			SSI->DR[0] = cmd;
 			// ожидание освобождения буфера
-			while (!(SSI->SR & TFE) || (SSI->SR & BUSY)) {
-				if (!tmp1--) {
-					return 1;
-				}
-			}
+			if (ssiWait(TFE | BUSY, TFE, timeout))
+				return 1;
 		} else {
 			// ожидание нового байта
-			tmp1 = timeout;
-			while (!(SSI->SR & RFNE)) {
-				if (!tmp1--) {
-					return 1;
-				}
-			}
+			if (ssiWait(RFNE, RFNE, timeout))
+				return 1;
+
 			buff[i - 1] = SNPS_SSI_readData(SSI);
 			if (!GET_SERVICE_SUBS_URB_OTP_FLAG_FLAG(REG(SERVICE_URB_OTP_FLAG))) {
+				// прием прерван, контроллер нужно сбросить перед следующим кадром
+				ssi_format.valid = false;
 				break;
 			}
 		}
@@ -424,41 +482,25 @@ static uint32_t readData(uint8_t ser, uint8_t cmd, uint8_t *buff, unsigned long
  * @param ser выбор сигнала slave select
  * @param cmd первый байт посылки
  * @param size количество dummy байт которые будут посланы после команды
- * @param timeout время ожидания завершения операции
+ * @param timeout время ожидания завершения операции в микросекундах
  * @return 0-Ok >1-произошла ошибка
  */
 static uint32_t writeDataContinue(uint8_t ser, uint8_t cmd, unsigned long size, uint32_t timeout)
 {
 	uint32_t errors = 0;
-	uint32_t tmp1;
-	uint32_t sr;
 
 	// ожидание завершения передачи
-	tmp1 = timeout;
-	while ((SSI->SR & BUSY)) {
-		if (!tmp1--) {
-			return 1;
-		}
-	}
+	if (ssiWait(BUSY, 0, timeout))
+		return 1;
 
-	// отключение контроллера и перенастройка
-	// необходимо настроить формат данных
-	SNPS_SSI_disableSsi(SSI);
-	SSI->SPI_CTRLR0 = INST_L_16bit | ADDR_L_0bit | TRANS_TYPE_10;
-	SNPS_SSI_setTransferMode(SSI, TX_ONLY);
-	SSI->CTRLR1 = 0;
-	SNPS_SSI_enableSsi(SSI);
+	// настройка формата данных
+	setFrameFormat(INST_L_16bit | ADDR_L_0bit | TRANS_TYPE_10, TX_ONLY, 0);
 	SSI->SER = ser;
 	uint32_t i;
 	for (i = 0; i < size; i++) {
-		tmp1 = timeout;
 		// проверка: FIFO не полный
-		do {
-			sr = SSI->SR;
-			if (!tmp1--) {
-				return 1;
-			}
-		} while (!(sr & TFNF));
+		if (ssiWait(TFNF, TFNF, timeout))
+			return 1;
 
 		// запись данных в буфер
 		if (i == 0) {
@@ -471,14 +513,9 @@ static uint32_t writeDataContinue(uint8_t ser, uint8_t cmd, unsigned long size,
 			}
 		}
 	}
-	tmp1 = timeout;
 	// проверка окончания передачи
-	do {
-		sr = SSI->SR;
-		if (!tmp1--) {
-			return 1;
-		}
-	} while ((!(sr & TFE)) || (sr & BUSY));
+	if (ssiWait(TFE | BUSY, TFE, timeout))
+		return 1;
 
 	SSI->SER = 0;
 	if (i == size) {
@@ -494,38 +531,22 @@ static uint32_t writeDataContinue(uint8_t ser, uint8_t cmd, unsigned long size,
  * @param ser выбор сигнала slave select
  * @param data указатель на массив передаваемых данных
  * @param size количество байт в массиве в data которые необходимо передать
- * @param timeout время ожидания выполнения операции
+ * @param timeout время ожидания выполнения операции в микросекундах
  * @return возвращает 1 если произошел timeout  и 0 успешное завершение
  */
 static int writeData(uint32_t ser, uint8_t cmd, uint8_t *data, uint32_t size, int timeout)
 {
-	unsigned tmp1;
-	uint32_t sr;
-
 	// ожидание завершения передачи
-	tmp1 = timeout;
-	while ((SSI->SR & BUSY)) {
-		if (!tmp1--) {
-			return 1;
-		}
-	}
-	// отключение контроллера и перенастройка
-	// необходимо настроить формат данных
-	SNPS_SSI_disableSsi(SSI);
-	SSI->SPI_CTRLR0 = INST_L_8bit | ADDR_L_0bit | TRANS_TYPE_10;
-	SNPS_SSI_setTransferMode(SSI, TX_ONLY);
-	SSI->CTRLR1 = 0;
-	SNPS_SSI_enableSsi(SSI);
+	if (ssiWait(BUSY, 0, timeout))
+		return 1;
+
+	// настройка формата данных, кадры INST и DATA передаются без перенастройки
+	setFrameFormat(INST_L_8bit | ADDR_L_0bit | TRANS_TYPE_10, TX_ONLY, 0);
 	SSI->SER = ser;
 	for (uint32_t i = 0; i < size + 1; i++) {
-		tmp1 = timeout;
 		// проверка: FIFO не полный
-		do {
-			sr = SSI->SR;
-			if (!tmp1--) {
-				return 1;
-			}
-		} while (!(sr & TFNF));
+		if (ssiWait(TFNF, TFNF, timeout))
+			return 1;
 
 		// запись данных в буфер
 		if (i == 0) {
@@ -534,14 +555,9 @@ static int writeData(uint32_t ser, uint8_t cmd, uint8_t *data, uint32_t size, in
 			SSI->DR[0] = data[i - 1];
 		}
 	}
-	tmp1 = timeout;
 	// проверка окончания передачи
-	do {
-		sr = SSI->SR;
-		if (!tmp1--) {
-			return 1;
-		}
-	} while ((!(sr & TFE)) || (sr & BUSY));
+	if (ssiWait(TFE | BUSY, TFE, timeout))
+		return 1;
 
 	SSI->SER = 0;
 	return 0;
@@ -555,8 +571,8 @@ static int writeData(uint32_t ser, uint8_t cmd, uint8_t *data, uint32_t size, in
  */
 static inline void shortFrame(uint8_t target, uint8_t cmd)
 {
-	writeData(INST_SS, target, NULL_PTR, NUL, TIMEOUT_OTP);
-	writeData(DATA_SS, cmd, NULL_PTR, NUL, TIMEOUT_OTP);
+	writeData(INST_SS, target, NULL_PTR, NUL, TIMEOUT_OTP_US);
+	writeData(DATA_SS, cmd, NULL_PTR, NUL, TIMEOUT_OTP_US);
 }
 
 /**
@@ -565,8 +581,8 @@ static inline void shortFrame(uint8_t target, uint8_t cmd)
  */
 static inline void start_cmd(uint32_t target)
 {
-	writeData(INST_SS, target, NULL_PTR, NUL, TIMEOUT_OTP);
-	writeDataContinue(DATA_SS, START_CMD, 0xffffff, TIMEOUT_OTP);
+	writeData(INST_SS, target, NULL_PTR, NUL, TIMEOUT_OTP_US);
+	writeDataContinue(DATA_SS, START_CMD, 0xffffff, TIMEOUT_OTP_US);
 }
 
 /**
@@ -588,12 +604,17 @@ static inline void stop_cmd(uint32_t target)
  */
 static inline int wrf_cmd(uint8_t target, uint32_t address, uint8_t *data, uint32_t size)
 {
+	unsigned long start = get_tick_counter();
 	uint32_t errors = 0;
 	uint8_t tmp = target;
 
-	errors += writeData(INST_SS, tmp, NULL_PTR, NUL, TIMEOUT_OTP);
+	errors += writeData(INST_SS, tmp, NULL_PTR, NUL, TIMEOUT_OTP_US);
 	tmp = WRF_CMD | (address & 0x3f);
-	errors += writeData(DATA_SS, tmp, data, size, TIMEOUT_OTP);
+	errors += writeData(DATA_SS, tmp, data, size, TIMEOUT_OTP_US);
+	otp_stats.cmds++;
+	otp_stats.cmd_ticks += ticks_since(start);
+	if (errors)
+		ssi_format.valid = false;
 
 	return errors ? OTP_ERR_BUS : 0;
 }
@@ -607,16 +628,147 @@ static inline int wrf_cmd(uint8_t target, uint32_t address, uint8_t *data, uint3
  */
 static int rdf_cmd(uint8_t target, uint32_t address, uint8_t *data, uint32_t size)
 {
+	unsigned long start = get_tick_counter();
 	uint32_t errors = 0;
 	uint8_t tmp = target;
 
-	errors += writeData(INST_SS, tmp, NULL_PTR, NUL, TIMEOUT_OTP);
+	errors += writeData(INST_SS, tmp, NULL_PTR, NUL, TIMEOUT_OTP_US);
 	tmp = RDF_CMD | (address & 0x3f);
-	errors += readData(DATA_SS, tmp, data, size, TIMEOUT_OTP);
+	errors += readData(DATA_SS, tmp, data, size, TIMEOUT_OTP_US);
+	otp_stats.cmds++;
+	otp_stats.cmd_ticks += ticks_since(start);
+	if (errors)
+		ssi_format.valid = false;
 
 	return errors ? OTP_ERR_BUS : 0;
 }
 
+/**
+ * @brief Ожидание завершения команды PMC
+ * @details Период опроса регистра состояния удваивается после каждого опроса от STATUS_POLL_US до
+ * STATUS_POLL_MAX_US мкс, чтобы во время длительных операций не загружать шину опросами.
+ * @param status сюда будет записано значение регистра состояния PMC
+ * @param polls сюда будет записано количество опросов регистра состояния
+ * @return 0 - Ok, OTP_ERR_BUS - ошибка шины SBPI, OTP_ERR_TIMEOUT - команда не завершилась
+ * за PMC_TIMEOUT_US мкс
+ */
+static int pmc_wait_done(uint8_t *status, uint32_t *polls)
+{
+	unsigned long start = get_tick_counter();
+	unsigned long timeout = (unsigned long)get_ticks_per_us() * PMC_TIMEOUT_US;
+	uint32_t delay = STATUS_POLL_US;
+
+	*polls = 0;
+	while (1) {
+		(*polls)++;
+		if (rdf_cmd(PMC_ID, PMC_CTRL_STATUS, status, 1))
+			return OTP_ERR_BUS;
+
+		if ((*status & 0xc0) == 0x40)
+			return 0;
+
+		if (ticks_since(start) >= timeout) {
+			otp_stats.pmc_timeouts++;
+			return OTP_ERR_TIMEOUT;
+		}
+
+		udelay(delay);
+		if (delay < STATUS_POLL_MAX_US)
+			delay *= 2;
+	}
+}
+
+static uint32_t stats_bucket(uint32_t value)
+{
+	uint32_t bucket = 0;
+
+	while (value > 1 && bucket < OTP_STATS_BUCKETS - 1) {
+		value >>= 1;
+		bucket++;
+	}
+
+	return bucket;
+}
+
+/**
+ * @brief Учет в статистике программирования одного слова
+ * @param addr адрес слова OTP
+ * @param start значение счетчика тиков в начале программирования слова
+ * @param polls количество опросов регистра состояния PMC
+ */
+static void stats_add_word(uint16_t addr, unsigned long start, uint32_t polls)
+{
+	uint32_t us = ticks_to_us(ticks_since(start));
+
+	otp_stats.words++;
+	otp_stats.word_us_total += us;
+	if (us < otp_stats.word_us_min)
+		otp_stats.word_us_min = us;
+
+	if (us >= otp_stats.word_us_max) {
+		otp_stats.word_us_max = us;
+		otp_stats.word_max_addr = addr;
+	}
+
+	otp_stats.time_hist[stats_bucket(us)]++;
+	otp_stats.poll_hist[stats_bucket(polls)]++;
+}
+
+struct otp_stats *otp_get_stats(void)
+{
+	return &otp_stats;
+}
+
+void otp_reset_stats(void)
+{
+	uint8_t *p = (uint8_t *)&otp_stats;
+
+	for (uint32_t i = 0; i < sizeof(otp_stats); i++)
+		p[i] = 0;
+
+	otp_stats.word_us_min = UINT32_MAX;
+}
+
+// Таблицы ECC: вклад каждого байта слова в ECC и номер бита данных по синдрому ошибки
+static uint8_t ecc_table[4][256];
+static int8_t ecc_syndrome_bit[64];
+static bool ecc_table_ready;
+
+/**
+ * @brief Заполнение таблиц ECC
+ * @details Бит i ECC - четность битов данных, выбранных маской P[i]. Столбец проверочной матрицы
+ * для бита данных b (синдром одиночной ошибки в этом бите) содержит бит i, если бит b есть в P[i].
+ */
+static void otp_ecc_init(void)
+{
+	const uint32_t P[6] = { 0x56aaad5b, 0x9b33366d, 0xe3c3c78e,
+				0x03fc07f0, 0x03fff800, 0xfc000000 };
+	uint8_t column[32];
+
+	for (uint32_t i = 0; i < ARRAY_LENGTH(ecc_syndrome_bit); i++)
+		ecc_syndrome_bit[i] = -1;
+
+	for (uint32_t b = 0; b < 32; b++) {
+		column[b] = 0;
+		for (uint32_t i = 0; i < 6; i++)
+			column[b] |= ((P[i] >> b) & 1) << i;
+
+		ecc_syndrome_bit[column[b]] = b;
+	}
+
+	for (uint32_t k = 0; k < 4; k++) {
+		for (uint32_t v = 0; v < 256; v++) {
+			ecc_table[k][v] = 0;
+			for (uint32_t j = 0; j < 8; j++) {
+				if (v & BIT(j))
+					ecc_table[k][v] ^= column[k * 8 + j];
+			}
+		}
+	}
+
+	ecc_table_ready = true;
+}
+
 /**
  * @brief Функция вычисляет 6 бит кода коррекции ошибки для последующего сравнения с прочитанным значением
  * @param data исходные данные для которых необходимо вычислить код коррекции
@@ -624,31 +776,56 @@ static int rdf_cmd(uint8_t target, uint32_t address, uint8_t *data, uint32_t siz
  */
 uint8_t otp_calculate_ecc(uint32_t data)
 {
-	uint32_t dataTmp;
-	uint32_t ecc = 0;
-	const uint32_t P[6] = { 0x56aaad5b, 0x9b33366d, 0xe3c3c78e,
-				0x03fc07f0, 0x03fff800, 0xfc000000 };
+	if (!ecc_table_ready)
+		otp_ecc_init();
 
-	for (uint32_t i = 0; i < 6; i++) {
-		dataTmp = data & P[i];
-		dataTmp ^= (dataTmp >> 16);
-		dataTmp ^= (dataTmp >> 8);
-		dataTmp ^= (dataTmp >> 4);
-		dataTmp &= 0xf;
-		ecc |= ((0x6996 >> dataTmp) & 1) << i;
-	}
+	return ecc_table[0][data & 0xff] ^ ecc_table[1][(data >> 8) & 0xff] ^
+	       ecc_table[2][(data >> 16) & 0xff] ^ ecc_table[3][data >> 24];
+}
 
-	return ecc;
+/**
+ * @brief Проверка ECC массива слов OTP
+ * @details По синдрому (разность вычисленного и прочитанного ECC) определяется одиночная ошибка
+ * в бите данных или в бите ECC. Остальные синдромы означают неисправимую ошибку.
+ * @param data прочитанные данные
+ * @param ecc прочитанные ECC
+ * @param count количество слов
+ * @param result сюда будет записан результат проверки каждого слова (OTP_ECC_*)
+ */
+void otp_ecc_decode(uint32_t *data, uint8_t *ecc, uint32_t count, uint8_t *result)
+{
+	for (uint32_t i = 0; i < count; i++) {
+		uint8_t syndrome = (otp_calculate_ecc(data[i]) ^ ecc[i]) & 0x3f;
+		uint8_t bit = 0;
+
+		if (!syndrome) {
+			result[i] = OTP_ECC_OK;
+		} else if (!(syndrome & (syndrome - 1))) {
+			while (!(syndrome & BIT(bit)))
+				bit++;
+
+			result[i] = OTP_ECC_ECC_BIT | bit;
+		} else if (ecc_syndrome_bit[syndrome] >= 0) {
+			result[i] = OTP_ECC_DATA_BIT | ecc_syndrome_bit[syndrome];
+		} else {
+			result[i] = OTP_ECC_UNCORRECTABLE;
+		}
+	}
 }
 
-static inline void otp_set_eccbrp_flags(uint8_t flag)
+static inline int otp_set_eccbrp_flags(uint8_t flag)
 {
 	uint8_t reg_value = 0;
+	int ret;
+
+	ret = rdf_cmd(DAP_ID, DAP_DPCR, &reg_value, 1);
+	if (ret)
+		return ret;
 
-	rdf_cmd(DAP_ID, DAP_DPCR, &reg_value, 1);
 	reg_value &= ~OTP_FLAG_MASK;
 	reg_value |= flag;
-	wrf_cmd(DAP_ID, DAP_DPCR, &reg_value, 1);
+
+	return wrf_cmd(DAP_ID, DAP_DPCR, &reg_value, 1);
 }
 
 static inline void otp_set_mode_direct_read(void)
@@ -664,17 +841,58 @@ static inline void otp_set_mode_sbpi(void)
 	__sync_synchronize();
 }
 
-void otp_read(uint32_t *buf_data, uint8_t *buf_ecc, uint32_t otp_addr, uint32_t count, uint8_t flags)
+static void otp_shadow_invalidate(void)
 {
-	otp_set_mode_sbpi();
-	otp_set_eccbrp_flags(flags);
-	otp_set_mode_direct_read();
+	for (int i = 0; i < SHADOW_SLOTS; i++)
+		otp_shadow[i].valid = false;
+}
+
+/**
+ * @brief Чтение слов OTP
+ * @details При первом чтении с указанными флагами все слова OTP считываются в копию в ОЗУ,
+ * последующие чтения с теми же флагами выполняются из копии без обращения к шине SBPI.
+ * @param buf_data сюда будут записаны данные
+ * @param buf_ecc сюда будут записаны ECC
+ * @param otp_addr начальный адрес OTP памяти (в диапазоне 0..128)
+ * @param count количество слов (в диапазоне 1..128)
+ * @param flags флаги ECC/BRP (OTP_FLAG_*)
+ * @return 0 - Ok, OTP_ERR_BUS - не удалось установить флаги ECC/BRP, данные не считаны
+ */
+int otp_read(uint32_t *buf_data, uint8_t *buf_ecc, uint32_t otp_addr, uint32_t count, uint8_t flags)
+{
+	int slot;
+	int ret;
+
+	for (slot = 0; slot < SHADOW_SLOTS; slot++) {
+		if (otp_shadow[slot].valid && otp_shadow[slot].flags == flags)
+			break;
+	}
+
+	if (slot == SHADOW_SLOTS) {
+		otp_set_mode_sbpi();
+		ret = otp_set_eccbrp_flags(flags);
+		if (ret)
+			return ret;
+
+		slot = otp_shadow_next;
+		otp_shadow_next = (otp_shadow_next + 1) % SHADOW_SLOTS;
+		otp_set_mode_direct_read();
+		for (uint32_t i = 0; i < OTP_WORDS_COUNT; i++) {
+			otp_shadow[slot].data[i] = REG(SERVICE_OTP + (i * 4));
+			otp_shadow[slot].ecc[i] = REG(SERVICE_URB_OTP_ECC);
+		}
+
+		otp_set_mode_sbpi();
+		otp_shadow[slot].flags = flags;
+		otp_shadow[slot].valid = true;
+	}
+
 	for (uint32_t i = 0; i < count; i++) {
-		buf_data[i] = REG(SERVICE_OTP + ((otp_addr + i) * 4));
-		buf_ecc[i] = REG(SERVICE_URB_OTP_ECC);
+		buf_data[i] = otp_shadow[slot].data[otp_addr + i];
+		buf_ecc[i] = otp_shadow[slot].ecc[otp_addr + i];
 	}
 
-	otp_set_mode_sbpi();
+	return 0;
 }
 
 /**
@@ -686,11 +904,17 @@ void otp_read(uint32_t *buf_data, uint8_t *buf_ecc, uint32_t otp_addr, uint32_t
  * @param otp_addr начальный адрес OTP памяти (в диапазоне 0..128)
  * @param count количество слов, которое необходимо запрограммировать (в диапазоне 1..128)
  * @param err_addr в случае ошибки сюда будет записан адрес слова OTP, на котором произошла ошибка
+ * @param is_burst если не равно нулю, то все слова программируются за один сеанс PMC: команда
+ *                 остановки передается только после последнего слова или при ошибке, адрес
+ *                 следующего слова задается автоинкрементом DAP OAR
  * @return 0 - Ok, отрацательное значение - ошибка программирования
  */
-int otp_program(uint32_t *buffer, uint8_t *ecc, uint16_t otp_addr, uint32_t count, uint16_t *err_addr)
+int otp_program(uint32_t *buffer, uint8_t *ecc, uint16_t otp_addr, uint32_t count, uint16_t *err_addr,
+		int is_burst)
 {
 	uint8_t status = 0;
+	bool is_started = false;
+	int ret = 0;
 	union dap_regs dap = {
 		.iref = 1,
 		.vrr = 8,
@@ -735,6 +959,7 @@ int otp_program(uint32_t *buffer, uint8_t *ecc, uint16_t otp_addr, uint32_t coun
 		.ctrl_status = PROG_INST,
 	};
 
+	otp_shadow_invalidate();
 	otp_set_mode_sbpi();
 
 	if (wrf_cmd(PMC_ID, 0x30, pmc.bytes, sizeof(pmc)))
@@ -744,35 +969,137 @@ int otp_program(uint32_t *buffer, uint8_t *ecc, uint16_t otp_addr, uint32_t coun
 		return OTP_ERR_BUS;
 
 	for (uint32_t i = 0; i < count; i++) {
-		if (wrf_cmd(DAP_ID, DAP_DR, (uint8_t *)&buffer[i], 4))
-			return OTP_ERR_BUS;
+		unsigned long start = get_tick_counter();
+		uint32_t polls = 0;
 
-		if (ecc) {
-			if (wrf_cmd(DAP_ID, 0x20, &ecc[i], 1))
-				return OTP_ERR_BUS;
+		if (wrf_cmd(DAP_ID, DAP_DR, (uint8_t *)&buffer[i], 4) ||
+		    (ecc && wrf_cmd(DAP_ID, 0x20, &ecc[i], 1))) {
+			ret = OTP_ERR_BUS;
+			break;
 		}
 
 		start_cmd(PMC_ID);
-		do {
-			if (rdf_cmd(PMC_ID, PMC_CTRL_STATUS, (uint8_t *)&status, 1))
-				return OTP_ERR_BUS;
-		} while ((status & 0xc0) != 0x40);
+		is_started = true;
+		ret = pmc_wait_done(&status, &polls);
+		if (ret)
+			break;
 
-		stop_cmd(PMC_ID);
 		status &= 0x30;
-		if (status) {
-			if (err_addr) {
-				if (rdf_cmd(DAP_ID, DAP_OAR, (uint8_t *)err_addr, 2))
-					return OTP_ERR_BUS;
-			}
+		if (!is_burst || status || i == count - 1) {
+			stop_cmd(PMC_ID);
+			is_started = false;
+		}
+
+		stats_add_word(otp_addr + i, start, polls);
 
-			if (status == 0x10)
-				return OTP_ERR_PROG_SOAK_LIMIT;
+		if (status) {
+			if (err_addr && rdf_cmd(DAP_ID, DAP_OAR, (uint8_t *)err_addr, 2))
+				ret = OTP_ERR_BUS;
+			else if (status == 0x10)
+				ret = OTP_ERR_PROG_SOAK_LIMIT;
 			else if (status == 0x20)
-				return OTP_ERR_PROG_COMPARE;
+				ret = OTP_ERR_PROG_COMPARE;
+			else
+				ret = OTP_ERR;
+			break;
+		}
+	}
 
-			return OTP_ERR;
+	// Сеанс PMC остается открытым только при ошибке, его необходимо завершить
+	if (is_started)
+		stop_cmd(PMC_ID);
+
+	return ret;
+}
+
+/**
+ * @brief Составление плана дифференциального программирования
+ * @details Текущее содержимое OTP считывается без коррекции ECC. Слово нужно программировать,
+ * если оно отличается от требуемого. Программирование невозможно, если в слове или в его ECC
+ * есть биты, равные 1, которые должны стать равными 0.
+ * @param buffer указатель на требуемые значения слов
+ * @param ecc указатель на требуемые значения ECC. Если NULL, то ECC рассчитывается автоматически.
+ * @param otp_addr начальный адрес OTP памяти (в диапазоне 0..128)
+ * @param count количество слов (в диапазоне 1..128)
+ * @param plan сюда будет записано действие для каждого слова (enum otp_word_plan)
+ * @return количество слов, которые невозможно запрограммировать, или OTP_ERR_BUS - ошибка чтения OTP
+ */
+int otp_plan(uint32_t *buffer, uint8_t *ecc, uint16_t otp_addr, uint32_t count, uint8_t *plan)
+{
+	uint32_t data[OTP_WORDS_COUNT];
+	uint8_t cur_ecc[OTP_WORDS_COUNT];
+	int conflicts = 0;
+	int ret;
+
+	ret = otp_read(data, cur_ecc, otp_addr, count, OTP_FLAG_ECC_DIS);
+	if (ret)
+		return ret;
+
+	for (uint32_t i = 0; i < count; i++) {
+		uint8_t new_ecc = (ecc ? ecc[i] : otp_calculate_ecc(buffer[i])) & 0x3f;
+
+		cur_ecc[i] &= 0x3f;
+		if (data[i] == buffer[i] && cur_ecc[i] == new_ecc) {
+			plan[i] = OTP_WORD_UNCHANGED;
+		} else if ((data[i] & ~buffer[i]) || (cur_ecc[i] & ~new_ecc)) {
+			plan[i] = OTP_WORD_CONFLICT;
+			conflicts++;
+		} else {
+			plan[i] = OTP_WORD_PROGRAM;
+		}
+	}
+
+	return conflicts;
+}
+
+/**
+ * @brief Дифференциальное программирование слов OTP
+ * @details Программируются только слова, отличающиеся от требуемых. Если хотя бы одно слово
+ * невозможно запрограммировать, то программирование не выполняется.
+ * @param buffer указатель на требуемые значения слов
+ * @param otp_addr начальный адрес OTP памяти (в диапазоне 0..128)
+ * @param count количество слов (в диапазоне 1..128)
+ * @param err_addr в случае ошибки сюда будет записан адрес слова OTP, на котором произошла ошибка
+ * @param is_burst программировать последовательные слова за один сеанс PMC (см. otp_program)
+ * @return 0 - Ok, отрицательное значение - ошибка программирования
+ */
+int otp_program_diff(uint32_t *buffer, uint16_t otp_addr, uint32_t count, uint16_t *err_addr,
+		     int is_burst)
+{
+	uint8_t plan[OTP_WORDS_COUNT];
+	uint32_t start;
+	int ret;
+
+	ret = otp_plan(buffer, NULL_PTR, otp_addr, count, plan);
+	if (ret < 0) {
+		if (err_addr)
+			*err_addr = otp_addr;
+
+		return ret;
+	} else if (ret) {
+		for (uint32_t i = 0; i < count; i++) {
+			if (plan[i] == OTP_WORD_CONFLICT) {
+				if (err_addr)
+					*err_addr = otp_addr + i;
+				break;
+			}
 		}
+
+		return OTP_ERR_PROG_CONFLICT;
+	}
+
+	for (uint32_t i = 0; i < count; i++) {
+		if (plan[i] != OTP_WORD_PROGRAM)
+			continue;
+
+		start = i;
+		while (i + 1 < count && plan[i + 1] == OTP_WORD_PROGRAM)
+			i++;
+
+		ret = otp_program(&buffer[start], NULL_PTR, otp_addr + start, i - start + 1, err_addr,
+				  is_burst);
+		if (ret)
+			return ret;
 	}
 
 	return 0;
@@ -784,11 +1111,16 @@ int otp_program(uint32_t *buffer, uint8_t *ecc, uint16_t otp_addr, uint32_t coun
  * @param count количество слов, которое необходимо проверить (в диапазоне 1..128)
  * @param is_bisr если не равно нулю, то проверять с исправлением
  * @param err_addr в случае ошибки сюда будет записан адрес слова OTP, на котором произошла ошибка
- * @return 0 - Ok, отрицательное значение - ошибка
+ * @return 0 - Ok, OTP_ERR - BIST обнаружил неисправное слово, OTP_ERR_BUS - ошибка шины SBPI,
+ * OTP_ERR_TIMEOUT - BIST не завершился за отведенное время
  */
 int otp_bist(uint16_t otp_addr, uint16_t count, int is_bisr, uint16_t *err_addr)
 {
+	unsigned long start;
+	uint32_t polls = 0;
+	uint32_t us;
 	uint8_t status = 0;
+	int ret;
 	union dap_regs dap = {
 		.iref = 1,
 		.vrr = 8,
@@ -828,21 +1160,31 @@ int otp_bist(uint16_t otp_addr, uint16_t count, int is_bisr, uint16_t *err_addr)
 		.cq_bist.program_enable = !!is_bisr,
 	};
 
+	if (is_bisr)
+		otp_shadow_invalidate();
+
 	otp_set_mode_sbpi();
 
 	if (wrf_cmd(PMC_ID, 0x30, pmc.bytes, sizeof(pmc)))
-		return -1;
+		return OTP_ERR_BUS;
 
 	if (wrf_cmd(DAP_ID, 0x30, dap.bytes, sizeof(dap)))
-		return -1;
+		return OTP_ERR_BUS;
 
+	start = get_tick_counter();
 	start_cmd(PMC_ID);
-	do {
-		if (rdf_cmd(PMC_ID, PMC_CTRL_STATUS, &status, 1))
-			return OTP_ERR_BUS;
-	} while ((status & 0xc0) != 0x40);
-
+	ret = pmc_wait_done(&status, &polls);
 	stop_cmd(PMC_ID);
+	if (ret)
+		return ret;
+
+	us = ticks_to_us(ticks_since(start));
+	otp_stats.bist_runs++;
+	otp_stats.bist_us_total += us;
+	otp_stats.bist_polls += polls;
+	if (us > otp_stats.bist_us_max)
+		otp_stats.bist_us_max = us;
+
 	if (status & 0x30) {
 		if (err_addr) {
 			if (rdf_cmd(DAP_ID, DAP_OAR, (uint8_t *)err_addr, 2))
@@ -854,3 +1196,45 @@ int otp_bist(uint16_t otp_addr, uint16_t count, int is_bisr, uint16_t *err_addr)
 
 	return 0;
 }
+
+/**
+ * @brief Поиск всех неисправных слов в диапазоне с помощью BIST
+ * @details После каждой ошибки BIST перезапускается со следующего за ошибочным слова.
+ * @param otp_addr начальный адрес OTP памяти (в диапазоне 0..128)
+ * @param count количество слов, которое необходимо проверить (в диапазоне 1..128)
+ * @param is_bisr если не равно нулю, то проверять с исправлением
+ * @param map битовая карта неисправных слов (OTP_MAP_SIZE байт, бит N - слово N)
+ * @return количество неисправных слов, отрицательное значение - ошибка шины или таймаут
+ */
+int otp_bist_map(uint16_t otp_addr, uint16_t count, int is_bisr, uint8_t *map)
+{
+	uint32_t end = otp_addr + count;
+	uint32_t addr = otp_addr;
+	uint16_t err_addr;
+	int failed = 0;
+	int ret;
+
+	for (uint32_t i = 0; i < OTP_MAP_SIZE; i++)
+		map[i] = 0;
+
+	while (addr < end) {
+		err_addr = 0;
+		ret = otp_bist(addr, end - addr, is_bisr, &err_addr);
+		if (!ret)
+			break;
+
+		// Только OTP_ERR означает, что BIST обнаружил неисправное слово
+		if (ret != OTP_ERR)
+			return ret;
+
+		// Адрес вне проверяемого диапазона означает, что продолжить проверку нельзя
+		if (err_addr < addr || err_addr >= end)
+			return OTP_ERR;
+
+		map[err_addr / 8] |= BIT(err_addr % 8);
+		failed++;
+		addr = err_addr + 1;
+	}
+
+	return failed;
+}
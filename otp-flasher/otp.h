@@ -16,17 +16,62 @@
 #define OTP_FLAG_MASK	 (OTP_FLAG_ECC_DIS | OTP_FLAG_ECC_GEN | OTP_FLAG_ECC_TST | OTP_FLAG_BRP_DIS | OTP_FLAG_BRP_GEN)
 
 #define OTP_WORDS_COUNT 128
+#define OTP_MAP_SIZE	(OTP_WORDS_COUNT / 8)
+
+// Результат проверки ECC слова OTP (см. otp_ecc_decode)
+#define OTP_ECC_OK	      0
+#define OTP_ECC_DATA_BIT      0x40 // исправимая ошибка, младшие 5 бит - номер бита данных
+#define OTP_ECC_ECC_BIT	      0x80 // ошибка в ECC, младшие 3 бита - номер бита ECC
+#define OTP_ECC_UNCORRECTABLE 0xff
 
 #define OTP_ERR			-1
 #define OTP_ERR_BUS		-2
 #define OTP_ERR_PROG_SOAK_LIMIT -3
 #define OTP_ERR_PROG_COMPARE	-4
+#define OTP_ERR_PROG_CONFLICT	-5
+#define OTP_ERR_TIMEOUT		-6
+
+// Действие для слова при дифференциальном программировании
+enum otp_word_plan {
+	OTP_WORD_UNCHANGED, // слово уже содержит требуемое значение
+	OTP_WORD_PROGRAM, // слово нужно программировать
+	OTP_WORD_CONFLICT, // требуется перевод бита из 1 в 0, программирование невозможно
+};
+
+#define OTP_STATS_BUCKETS 16
+
+// Статистика программирования и BIST. Интервал N гистограммы - значения от 2^N до 2^(N+1)-1
+// (интервал 0 включает 0 и 1, последний интервал - все значения больше).
+struct otp_stats {
+	uint32_t words; // количество запрограммированных слов
+	uint32_t word_us_total;
+	uint32_t word_us_min;
+	uint32_t word_us_max;
+	uint16_t word_max_addr; // адрес слова с максимальным временем программирования
+	uint32_t bist_runs;
+	uint32_t bist_us_total;
+	uint32_t bist_us_max;
+	uint32_t bist_polls;
+	uint32_t pmc_timeouts; // количество команд PMC, не завершившихся за отведенное время
+	uint32_t cmds; // количество команд SBPI (wrf/rdf)
+	unsigned long cmd_ticks;
+	uint32_t time_hist[OTP_STATS_BUCKETS]; // время программирования слова, мкс
+	uint32_t poll_hist[OTP_STATS_BUCKETS]; // количество опросов состояния PMC на слово
+};
 
 void SBPI_initMaster(SNPS_SSI_regs_t *SSI);
+struct otp_stats *otp_get_stats(void);
+void otp_reset_stats(void);
 
-int otp_program(uint32_t *buffer, uint8_t *ecc, uint16_t idx_start, uint32_t count, uint16_t *err_addr);
+int otp_program(uint32_t *buffer, uint8_t *ecc, uint16_t idx_start, uint32_t count, uint16_t *err_addr,
+		int is_burst);
+int otp_plan(uint32_t *buffer, uint8_t *ecc, uint16_t otp_addr, uint32_t count, uint8_t *plan);
+int otp_program_diff(uint32_t *buffer, uint16_t otp_addr, uint32_t count, uint16_t *err_addr,
+		     int is_burst);
 int otp_bist(uint16_t otp_addr, uint16_t count, int is_bisr, uint16_t *err_addr);
-void otp_read(uint32_t *buf_data, uint8_t *buf_ecc, uint32_t otp_addr, uint32_t count, uint8_t flags);
+int otp_bist_map(uint16_t otp_addr, uint16_t count, int is_bisr, uint8_t *map);
+int otp_read(uint32_t *buf_data, uint8_t *buf_ecc, uint32_t otp_addr, uint32_t count, uint8_t flags);
 uint8_t otp_calculate_ecc(uint32_t data);
+void otp_ecc_decode(uint32_t *data, uint8_t *ecc, uint32_t count, uint8_t *result);
 
 #endif // _OTP_H_
@@ -7,6 +7,7 @@
 
 #include <clk.h>
 #include <console.h>
+#include <crc16.h>
 #include <delay.h>
 #include <gpio.h>
 #include <pvt.h>
@@ -20,6 +21,13 @@
 
 #define DEGREE_CELSIUS_UTF8_SYM "\xe2\x84\x83"
 
+/* Stream channel mask: bits [3:0] - TS of subsystems 0..3, bits [7:4] - VM of subsystems 0..3 */
+#define STREAM_CHANNELS	      8
+#define STREAM_TS_CHANNELS    4
+#define STREAM_WINDOW_DEFAULT 16
+#define STREAM_WINDOW_MAX     0xffff
+#define STREAM_NO_DATA	      0x8000
+
 // TODO: move to separate file (maybe common.c)
 // GCC uses __stack_chk_fail as stack overflow handler
 unsigned long __stack_chk_guard;
@@ -31,6 +39,9 @@ enum {
 	CMD_VERBOSE,
 	CMD_TVAL,
 	CMD_SEL_VIN,
+	CMD_CONT,
+	CMD_ALARM,
+	CMD_STREAM,
 };
 
 struct console_cmd console_cmd[] = {
@@ -79,6 +90,35 @@ struct console_cmd console_cmd[] = {
 		.arg_max = 1,
 		.arg_types = { ARG_UINT },
 	},
+	{
+		.cmd = "cont",
+		.help = "Continuous measurement on all channels. Usage: cont [start|stop|reset]. "
+			"Without arguments show latest samples, min/max and sample counts",
+		.cmd_id = CMD_CONT,
+		.arg_min = 0,
+		.arg_max = 1,
+		.arg_types = { ARG_STR },
+	},
+	{
+		.cmd = "alarm",
+		.help = "Set alarm threshold (m" DEGREE_CELSIUS_UTF8_SYM " for ts, mV for vm) and "
+			"hysteresis. Alarms are checked in continuous mode, events are printed as "
+			"they occur. Usage: alarm <ts|vm> <subsystem> <high|low|off> [value] [hyst]",
+		.cmd_id = CMD_ALARM,
+		.arg_min = 3,
+		.arg_max = 5,
+		.arg_types = { ARG_STR, ARG_UINT, ARG_STR, ARG_INT, ARG_UINT },
+	},
+	{
+		.cmd = "stream",
+		.help = "Stream binary frames with min/max/mean of each window of samples until any "
+			"byte is received. Channels is a mask: bits 0-3 - ts, bits 4-7 - vm. "
+			"Usage: stream <period_us> <channels> [window]",
+		.cmd_id = CMD_STREAM,
+		.arg_min = 2,
+		.arg_max = 3,
+		.arg_types = { ARG_UINT, ARG_UINT, ARG_UINT },
+	},
 };
 
 void console_run(struct console *console, struct console_cmd *cmd, struct console_arg *args,
@@ -97,6 +137,254 @@ void __stack_chk_fail(void)
 {
 }
 
+static void print_cont(struct console *console, const char *const *channel_names)
+{
+	uint32_t channel;
+	int32_t mc, mc_min, mc_max;
+	uint32_t mv, mv_min, mv_max;
+
+	if (!pvt_cont_is_running()) {
+		uart_puts(console->uart, "Continuous mode is stopped\n");
+		return;
+	}
+
+	for (channel = 0; channel < pvt_ts_count(); channel++) {
+		if (!pvt_ts_read_mcelsius(channel, &mc) ||
+		    !pvt_ts_get_minmax(channel, &mc_min, &mc_max)) {
+			uart_printf(console->uart, "TS[%d:%s]: no data\n", channel,
+				    channel_names[channel]);
+			continue;
+		}
+
+		uart_printf(console->uart,
+			    "TS[%d:%s]: %d m" DEGREE_CELSIUS_UTF8_SYM " (min %d, max %d)\n",
+			    channel, channel_names[channel], mc, mc_min, mc_max);
+	}
+
+	for (channel = 0; channel < pvt_vm_count(); channel++) {
+		if (!pvt_vm_read_mv(channel, &mv) ||
+		    !pvt_vm_get_minmax(channel, &mv_min, &mv_max)) {
+			uart_printf(console->uart, "VM[%d:%s]: no data\n", channel,
+				    channel_names[channel]);
+			continue;
+		}
+
+		uart_printf(console->uart, "VM[%d:%s]: %d mV (min %d, max %d)\n", channel,
+			    channel_names[channel], mv, mv_min, mv_max);
+	}
+
+	uart_printf(console->uart, "Samples: TS %u, VM %u\n", pvt_ts_samples(), pvt_vm_samples());
+}
+
+static void set_alarm(struct console *console, struct console_arg *args, int argc)
+{
+	enum pvt_sensor sensor;
+	enum pvt_alarm alarm;
+
+	if (!strcmp(args[0].str, "ts")) {
+		sensor = PVT_TS;
+	} else if (!strcmp(args[0].str, "vm")) {
+		sensor = PVT_VM;
+	} else {
+		uart_puts(console->uart, "Error: Unknown sensor\n");
+		return;
+	}
+
+	if (args[1].uint >= (sensor == PVT_TS ? pvt_ts_count() : pvt_vm_count())) {
+		uart_puts(console->uart, "Error: Invalid subsystem\n");
+		return;
+	}
+
+	if (!strcmp(args[2].str, "off")) {
+		pvt_disable_alarm(sensor, args[1].uint, PVT_ALARM_HIGH);
+		pvt_disable_alarm(sensor, args[1].uint, PVT_ALARM_LOW);
+		return;
+	} else if (!strcmp(args[2].str, "high")) {
+		alarm = PVT_ALARM_HIGH;
+	} else if (!strcmp(args[2].str, "low")) {
+		alarm = PVT_ALARM_LOW;
+	} else {
+		uart_puts(console->uart, "Error: Unknown mode\n");
+		return;
+	}
+
+	if (argc < 4) {
+		uart_puts(console->uart, "Error: Threshold is not specified\n");
+		return;
+	}
+
+	if (pvt_set_alarm(sensor, args[1].uint, alarm, (int32_t)args[3].uint,
+			  argc > 4 ? args[4].uint : 0))
+		uart_puts(console->uart, "Error: Invalid subsystem\n");
+	else if (!pvt_cont_is_running())
+		pvt_cont_start();
+}
+
+static void print_events(void)
+{
+	const char *const sensor_names[] = { "TS", "VM" };
+	const char *const alarm_names[] = { "high", "low" };
+	struct pvt_event event;
+
+	while (pvt_get_event(&event)) {
+		uart_printf(UART0, "[%u] %s[%d] %s alarm %s: %d%s\n", (uint32_t)event.tick,
+			    sensor_names[event.sensor], event.channel, alarm_names[event.alarm],
+			    event.active ? "raised" : "released", event.value,
+			    event.sensor == PVT_TS ? " m" DEGREE_CELSIUS_UTF8_SYM : " mV");
+	}
+}
+
+struct stream_acc {
+	int32_t min;
+	int32_t max;
+	int32_t sum;
+	uint32_t count;
+};
+
+static uint16_t put_u16(uint8_t *buf, uint16_t pos, uint32_t value)
+{
+	buf[pos++] = value & 0xff;
+	buf[pos++] = (value >> 8) & 0xff;
+
+	return pos;
+}
+
+/* Frame: | '#' | seq (2) | tick (4) | samples (2) | overruns (2) |
+ *        | min (2) | max (2) | mean (2) | ... for each channel of the mask | crc16 (2) |
+ * All fields are little-endian, CRC16 is calculated over all bytes after '#'.
+ */
+static void stream_send_frame(struct console *console, uint32_t seq, uint16_t samples,
+			      uint16_t overruns, struct stream_acc *acc, uint32_t channels)
+{
+	uint8_t buf[10 + STREAM_CHANNELS * 6];
+	uint32_t tick = get_tick_counter();
+	uint16_t crc = crc16_init();
+	uint16_t pos = 0;
+
+	pos = put_u16(buf, pos, seq);
+	pos = put_u16(buf, pos, tick);
+	pos = put_u16(buf, pos, tick >> 16);
+	pos = put_u16(buf, pos, samples);
+	pos = put_u16(buf, pos, overruns);
+	for (int i = 0; i < STREAM_CHANNELS; i++) {
+		if (!(channels & BIT(i)))
+			continue;
+
+		if (!acc[i].count) {
+			pos = put_u16(buf, pos, STREAM_NO_DATA);
+			pos = put_u16(buf, pos, STREAM_NO_DATA);
+			pos = put_u16(buf, pos, STREAM_NO_DATA);
+			continue;
+		}
+
+		pos = put_u16(buf, pos, acc[i].min);
+		pos = put_u16(buf, pos, acc[i].max);
+		pos = put_u16(buf, pos, acc[i].sum / (int32_t)acc[i].count);
+	}
+
+	uart_putc_raw(console->uart, '#');
+	for (int i = 0; i < pos; i++) {
+		uart_putc_raw(console->uart, buf[i]);
+		crc = crc16_update_byte(crc, buf[i]);
+	}
+
+	uart_putc_raw(console->uart, crc & 0xff);
+	uart_putc_raw(console->uart, crc >> 8);
+}
+
+static void stream_reset(struct stream_acc *acc)
+{
+	for (int i = 0; i < STREAM_CHANNELS; i++) {
+		acc[i].min = INT32_MAX;
+		acc[i].max = INT32_MIN;
+		acc[i].sum = 0;
+		acc[i].count = 0;
+	}
+}
+
+static void stream_sample(struct stream_acc *acc, uint32_t channels)
+{
+	int32_t value;
+	int32_t mcelsius;
+	uint32_t mv;
+
+	for (int i = 0; i < STREAM_CHANNELS; i++) {
+		if (!(channels & BIT(i)))
+			continue;
+
+		// TS is reported in 0.01 degree Celsius to fit into 16 bits
+		if (i < STREAM_TS_CHANNELS) {
+			if (!pvt_ts_read_mcelsius(i, &mcelsius))
+				continue;
+
+			value = mcelsius / 10;
+		} else {
+			if (!pvt_vm_read_mv(i - STREAM_TS_CHANNELS, &mv))
+				continue;
+
+			value = mv;
+		}
+
+		if (value < acc[i].min)
+			acc[i].min = value;
+
+		if (value > acc[i].max)
+			acc[i].max = value;
+
+		acc[i].sum += value;
+		acc[i].count++;
+	}
+}
+
+static void stream(struct console *console, uint32_t period_us, uint32_t channels,
+		   uint32_t window)
+{
+	struct stream_acc acc[STREAM_CHANNELS];
+	unsigned long period = (unsigned long)period_us * get_ticks_per_us();
+	unsigned long last_tick;
+	uint32_t seq = 0;
+	uint16_t samples = 0;
+	uint16_t overruns = 0;
+
+	if (!period_us || !channels || channels & ~GENMASK(STREAM_CHANNELS - 1, 0) || !window ||
+	    window > STREAM_WINDOW_MAX) {
+		uart_puts(console->uart, "Error: Invalid arguments\n");
+		return;
+	}
+
+	if (!pvt_cont_is_running())
+		pvt_cont_start();
+
+	uart_printf(console->uart, "Streaming, ticks per us: %u. Send any byte to stop\n",
+		    get_ticks_per_us());
+
+	stream_reset(acc);
+	last_tick = get_tick_counter();
+	while (!uart_is_char_ready(console->uart)) {
+		if (ticks_since(last_tick) < period)
+			continue;
+
+		// Keep fixed rate, but do not try to catch up if frame output took too long
+		last_tick += period;
+		if (ticks_since(last_tick) >= period) {
+			last_tick = get_tick_counter();
+			overruns++;
+		}
+
+		stream_sample(acc, channels);
+		if (++samples < window)
+			continue;
+
+		stream_send_frame(console, seq++, samples, overruns, acc, channels);
+		stream_reset(acc);
+		samples = 0;
+		overruns = 0;
+	}
+
+	uart_getchar(console->uart);
+	uart_printf(console->uart, "\nStopped after %u frames\n", seq);
+}
+
 void console_run(struct console *console, struct console_cmd *cmd, struct console_arg *args,
 		 int argc)
 {
@@ -151,6 +439,26 @@ void console_run(struct console *console, struct console_cmd *cmd, struct consol
 		break;
 	case CMD_SEL_VIN:
 		pvt_vm_set_sel_vin(args[0].uint);
+		break;
+	case CMD_ALARM:
+		set_alarm(console, args, argc);
+		break;
+	case CMD_STREAM:
+		stream(console, args[0].uint, args[1].uint,
+		       argc > 2 ? args[2].uint : STREAM_WINDOW_DEFAULT);
+		break;
+	case CMD_CONT:
+		if (!argc)
+			print_cont(console, channel_names);
+		else if (!strcmp(args[0].str, "start"))
+			pvt_cont_start();
+		else if (!strcmp(args[0].str, "stop"))
+			pvt_cont_stop();
+		else if (!strcmp(args[0].str, "reset"))
+			pvt_reset_minmax();
+		else
+			uart_puts(console->uart, "Error: Unknown mode\n");
+
 		break;
 	default:
 		break;
@@ -228,6 +536,8 @@ int main(void)
 	console_cmd_line_restore(&console);
 	while (1) {
 		console_process(&console);
+		if (pvt_poll_events())
+			print_events();
 	}
 
 	return 0;
@@ -29,6 +29,11 @@
 
 #define DEGREE_CELSIUS_UTF8_SYM "\xe2\x84\x83"
 
+// Thermal alarm for SERVICE subsystem sensor
+#define TEMP_ALARM_CHANNEL 3
+#define TEMP_ALARM_MC	   100000
+#define TEMP_ALARM_HYST_MC 5000
+
 /* ARM CPU program can be linked from binary, but this requires to add project, compile it, write
  * link script to add binary from new project to this binary. We add simple ARM program to
  * array in .data section instead. This is easiest way.
@@ -1053,6 +1058,9 @@ int main(void)
 	set_led(TEST_ERROR, 0);
 
 	pvt_init();
+	pvt_cont_start();
+	pvt_set_alarm(PVT_TS, TEMP_ALARM_CHANNEL, PVT_ALARM_HIGH, TEMP_ALARM_MC,
+		      TEMP_ALARM_HYST_MC);
 
 	last_tick_go_led = get_tick_counter();
 	last_tick_all_gpios = get_tick_counter();
@@ -1088,7 +1096,15 @@ int main(void)
 		if (ticks_to_us(ticks_since(last_tick_pvt)) >= 5000000) {
 			last_tick_pvt = get_tick_counter();
 			uart_printf(UART0, "temp = %d m" DEGREE_CELSIUS_UTF8_SYM "\n",
-				    pvt_ts_measure_mcelsius(3));
+				    pvt_ts_measure_mcelsius(TEMP_ALARM_CHANNEL));
+		}
+
+		if (pvt_poll_events()) {
+			struct pvt_event event;
+
+			while (pvt_get_event(&event))
+				uart_printf(UART0, "temp alarm %s: %d m" DEGREE_CELSIUS_UTF8_SYM "\n",
+					    event.active ? "raised" : "released", event.value);
 		}
 
 #if defined(USE_CPU) || defined(USE_SDR)
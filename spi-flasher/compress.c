@@ -0,0 +1,104 @@
+// SPDX-License-Identifier: MIT
+// Copyright 2025 RnD Center "ELVEES", JSC
+
+#include <stdint.h>
+
+#include <compress.h>
+
+#define LITERALS_MAX 128
+#define FILL_MIN     4
+#define FILL_MAX     (FILL_MIN + 0x3fff)
+#define MATCH_MIN    4
+#define MATCH_MAX    (MATCH_MIN + 0x3f)
+
+#define HASH_BITS  9
+#define HASH_EMPTY 0xffff
+
+static inline uint32_t hash3(const uint8_t *p)
+{
+	return ((p[0] << 6) ^ (p[1] << 3) ^ p[2]) & ((1 << HASH_BITS) - 1);
+}
+
+static uint32_t put_literals(const uint8_t *src, uint32_t len, uint8_t *dst)
+{
+	uint32_t pos = 0;
+
+	while (len) {
+		uint32_t n = len > LITERALS_MAX ? LITERALS_MAX : len;
+
+		dst[pos++] = n - 1;
+		for (uint32_t i = 0; i < n; i++)
+			dst[pos++] = src[i];
+
+		src += n;
+		len -= n;
+	}
+
+	return pos;
+}
+
+uint32_t compress_chunk(const uint8_t *src, uint32_t len, uint8_t *dst)
+{
+	uint16_t hash[1 << HASH_BITS];
+	uint32_t lit_start = 0;
+	uint32_t pos = 0;
+	uint32_t i = 0;
+
+	for (uint32_t j = 0; j < ARRAY_LENGTH(hash); j++)
+		hash[j] = HASH_EMPTY;
+
+	while (i < len) {
+		uint32_t max = len - i;
+		uint32_t n = 1;
+
+		// Runs of erased (0xff) and zeroed data are the most common case
+		if (max > FILL_MAX)
+			max = FILL_MAX;
+
+		while (n < max && src[i + n] == src[i])
+			n++;
+
+		if (n >= FILL_MIN) {
+			pos += put_literals(&src[lit_start], i - lit_start, &dst[pos]);
+			dst[pos++] = 0x80 | ((n - FILL_MIN) >> 8);
+			dst[pos++] = (n - FILL_MIN) & 0xff;
+			dst[pos++] = src[i];
+			i += n;
+			lit_start = i;
+			continue;
+		}
+
+		if (len - i >= MATCH_MIN) {
+			uint32_t h = hash3(&src[i]);
+			uint32_t cand = hash[h];
+
+			hash[h] = i;
+			max = len - i;
+			if (max > MATCH_MAX)
+				max = MATCH_MAX;
+
+			n = 0;
+			if (cand != HASH_EMPTY) {
+				while (n < max && src[cand + n] == src[i + n])
+					n++;
+			}
+
+			if (n >= MATCH_MIN) {
+				uint32_t dist = i - cand - 1;
+
+				pos += put_literals(&src[lit_start], i - lit_start, &dst[pos]);
+				dst[pos++] = 0xc0 | (n - MATCH_MIN);
+				dst[pos++] = dist & 0xff;
+				dst[pos++] = dist >> 8;
+				i += n;
+				lit_start = i;
+				continue;
+			}
+		}
+		i++;
+	}
+
+	pos += put_literals(&src[lit_start], i - lit_start, &dst[pos]);
+
+	return pos;
+}
@@ -0,0 +1,33 @@
+// SPDX-License-Identifier: MIT
+// Copyright 2025 RnD Center "ELVEES", JSC
+
+#ifndef COMPRESS_H_
+#define COMPRESS_H_
+
+#include <stdint.h>
+
+#include <regs.h>
+
+/* Size of uncompressed chunk that is packed into one frame */
+#define COMPRESS_CHUNK_SIZE 4096
+
+/* Worst case size of compressed chunk (all bytes are literals) */
+#define COMPRESS_BOUND(len) ((len) + DIV_ROUND_UP(len, 128))
+
+/* Compress data using RLE + LZ77 codec.
+ * Compressed stream is a sequence of tokens. Each token starts from control byte `c`:
+ *   0x00..0x7f - literals: (c + 1) bytes follow the control byte as is;
+ *   0x80..0xbf - fill: next byte `n`, then fill byte `b`. Output ((c & 0x3f) << 8 | n) + 4
+ *                bytes of `b`;
+ *   0xc0..0xff - match: next two bytes are distance-1 (little-endian). Copy (c & 0x3f) + 4 bytes
+ *                starting from (current position - distance) of already unpacked data. Source
+ *                and destination can overlap.
+ * Matches never refer to data outside of the chunk, so each chunk can be unpacked independently.
+ * src - data to compress (up to COMPRESS_CHUNK_SIZE bytes)
+ * len - length of data
+ * dst - buffer for compressed data (at least COMPRESS_BOUND(len) bytes)
+ * Return size of compressed data.
+ */
+uint32_t compress_chunk(const uint8_t *src, uint32_t len, uint8_t *dst);
+
+#endif
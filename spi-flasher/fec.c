@@ -0,0 +1,220 @@
+// SPDX-License-Identifier: MIT
+// Copyright 2025 RnD Center "ELVEES", JSC
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <fec.h>
+
+#define GF_POLY 0x11d
+
+static uint8_t gf_exp[512];
+static uint8_t gf_log[256];
+static uint8_t generator[FEC_PARITY + 1];
+static bool is_initialized;
+
+static inline uint8_t gf_mul(uint8_t a, uint8_t b)
+{
+	if (!a || !b)
+		return 0;
+
+	return gf_exp[gf_log[a] + gf_log[b]];
+}
+
+static inline uint8_t gf_div(uint8_t a, uint8_t b)
+{
+	if (!a)
+		return 0;
+
+	return gf_exp[gf_log[a] + 255 - gf_log[b]];
+}
+
+static void fec_init(void)
+{
+	uint32_t x = 1;
+
+	for (int i = 0; i < 255; i++) {
+		gf_exp[i] = x;
+		gf_log[x] = i;
+		x <<= 1;
+		if (x & 0x100)
+			x ^= GF_POLY;
+	}
+	for (int i = 255; i < 512; i++)
+		gf_exp[i] = gf_exp[i - 255];
+
+	// generator(x) = (x - a^0)(x - a^1)...(x - a^(FEC_PARITY - 1)), generator[i] is
+	// coefficient of x^i
+	generator[0] = 1;
+	for (int i = 0; i < FEC_PARITY; i++) {
+		generator[i + 1] = 0;
+		for (int j = i + 1; j > 0; j--)
+			generator[j] = generator[j - 1] ^ gf_mul(generator[j], gf_exp[i]);
+
+		generator[0] = gf_mul(generator[0], gf_exp[i]);
+	}
+	is_initialized = true;
+}
+
+void fec_encode(const uint8_t *data, uint32_t len, uint8_t *parity)
+{
+	if (!is_initialized)
+		fec_init();
+
+	for (int i = 0; i < FEC_PARITY; i++)
+		parity[i] = 0;
+
+	// parity[0] is the coefficient of the highest degree of remainder
+	for (uint32_t i = 0; i < len; i++) {
+		uint8_t feedback = data[i] ^ parity[0];
+
+		for (int j = 0; j < FEC_PARITY - 1; j++)
+			parity[j] = parity[j + 1] ^ gf_mul(feedback, generator[FEC_PARITY - 1 - j]);
+
+		parity[FEC_PARITY - 1] = gf_mul(feedback, generator[0]);
+	}
+}
+
+void fec_syndromes_init(uint8_t *synd)
+{
+	if (!is_initialized)
+		fec_init();
+
+	for (int i = 0; i < FEC_PARITY; i++)
+		synd[i] = 0;
+}
+
+void fec_syndromes_update(uint8_t *synd, uint8_t byte)
+{
+	synd[0] ^= byte;
+	for (int i = 1; i < FEC_PARITY; i++)
+		synd[i] = gf_mul(synd[i], gf_exp[i]) ^ byte;
+}
+
+int fec_correct(uint8_t *data, uint32_t len, uint8_t *parity, const uint8_t *synd)
+{
+	uint8_t lambda[FEC_PARITY + 1] = { 1 };
+	uint8_t prev[FEC_PARITY + 1] = { 1 };
+	uint8_t omega[FEC_PARITY];
+	uint32_t n = len + FEC_PARITY;
+	int errors = 0;
+	int degree = 0;
+	int shift = 1;
+	uint8_t prev_delta = 1;
+	bool is_clean = true;
+
+	for (int i = 0; i < FEC_PARITY; i++) {
+		if (synd[i])
+			is_clean = false;
+	}
+
+	if (is_clean)
+		return 0;
+
+	if (n > 255)
+		return -1;
+
+	// Berlekamp-Massey: find error locator polynomial lambda
+	for (int k = 0; k < FEC_PARITY; k++) {
+		uint8_t delta = synd[k];
+
+		for (int i = 1; i <= degree; i++)
+			delta ^= gf_mul(lambda[i], synd[k - i]);
+
+		if (!delta) {
+			shift++;
+			continue;
+		}
+
+		uint8_t tmp[FEC_PARITY + 1];
+		uint8_t coef = gf_div(delta, prev_delta);
+
+		for (int i = 0; i <= FEC_PARITY; i++)
+			tmp[i] = lambda[i];
+
+		for (int i = shift; i <= FEC_PARITY; i++)
+			lambda[i] ^= gf_mul(coef, prev[i - shift]);
+
+		if (2 * degree <= k) {
+			degree = k + 1 - degree;
+			for (int i = 0; i <= FEC_PARITY; i++)
+				prev[i] = tmp[i];
+
+			prev_delta = delta;
+			shift = 1;
+		} else
+			shift++;
+	}
+
+	if (degree > FEC_PARITY / 2)
+		return -1;
+
+	// omega(x) = synd(x) * lambda(x) mod x^FEC_PARITY
+	for (int i = 0; i < FEC_PARITY; i++) {
+		omega[i] = 0;
+		for (int j = 0; j <= i && j <= degree; j++)
+			omega[i] ^= gf_mul(lambda[j], synd[i - j]);
+	}
+
+	// Chien search and Forney algorithm. Byte at index pos of codeword is the coefficient
+	// of x^(n - 1 - pos), so its error locator is a^(n - 1 - pos).
+	for (uint32_t pos = 0; pos < n; pos++) {
+		uint32_t power = n - 1 - pos;
+		uint8_t x_inv = gf_exp[(255 - power) % 255];
+		uint8_t value = 0;
+		uint8_t x_pow = 1;
+		uint8_t num = 0;
+		uint8_t den = 0;
+
+		for (int i = 0; i <= degree; i++) {
+			value ^= gf_mul(lambda[i], x_pow);
+			x_pow = gf_mul(x_pow, x_inv);
+		}
+
+		if (value)
+			continue;
+
+		x_pow = 1;
+		for (int i = 0; i < FEC_PARITY; i++) {
+			num ^= gf_mul(omega[i], x_pow);
+			x_pow = gf_mul(x_pow, x_inv);
+		}
+
+		// Formal derivative of lambda contains only odd terms
+		x_pow = 1;
+		for (int i = 1; i <= degree; i += 2) {
+			den ^= gf_mul(lambda[i], x_pow);
+			x_pow = gf_mul(x_pow, gf_mul(x_inv, x_inv));
+		}
+
+		if (!den)
+			return -1;
+
+		value = gf_mul(gf_exp[power], gf_div(num, den));
+		if (pos < len)
+			data[pos] ^= value;
+		else
+			parity[pos - len] ^= value;
+
+		errors++;
+	}
+
+	if (errors != degree)
+		return -1;
+
+	return errors;
+}
+
+int fec_decode(uint8_t *data, uint32_t len, uint8_t *parity)
+{
+	uint8_t synd[FEC_PARITY];
+
+	fec_syndromes_init(synd);
+	for (uint32_t i = 0; i < len; i++)
+		fec_syndromes_update(synd, data[i]);
+
+	for (int i = 0; i < FEC_PARITY; i++)
+		fec_syndromes_update(synd, parity[i]);
+
+	return fec_correct(data, len, parity, synd);
+}
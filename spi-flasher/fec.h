@@ -0,0 +1,37 @@
+// SPDX-License-Identifier: MIT
+// Copyright 2025 RnD Center "ELVEES", JSC
+
+#ifndef FEC_H_
+#define FEC_H_
+
+#include <stdint.h>
+
+/* Reed-Solomon code over GF(256) (primitive polynomial 0x11d, first consecutive root 1).
+ * Data is split into segments of up to FEC_SEGMENT_SIZE bytes, each segment is followed by
+ * FEC_PARITY parity bytes. Up to FEC_PARITY / 2 corrupted bytes per segment are corrected.
+ */
+#define FEC_PARITY	 8
+#define FEC_SEGMENT_SIZE 128
+
+/* Calculate parity bytes for segment.
+ * data - segment data
+ * len - length of segment (up to 255 - FEC_PARITY bytes)
+ * parity - buffer for FEC_PARITY parity bytes
+ */
+void fec_encode(const uint8_t *data, uint32_t len, uint8_t *parity);
+
+/* Syndromes can be calculated on the fly while segment is being received.
+ * Call fec_syndromes_update() for every data byte and then for every parity byte.
+ */
+void fec_syndromes_init(uint8_t *synd);
+void fec_syndromes_update(uint8_t *synd, uint8_t byte);
+
+/* Correct segment using syndromes calculated by fec_syndromes_update().
+ * Return count of corrected bytes or -1 if segment can not be corrected.
+ */
+int fec_correct(uint8_t *data, uint32_t len, uint8_t *parity, const uint8_t *synd);
+
+/* Calculate syndromes and correct segment. Return value is the same as for fec_correct() */
+int fec_decode(uint8_t *data, uint32_t len, uint8_t *parity);
+
+#endif
@@ -0,0 +1,111 @@
+// SPDX-License-Identifier: MIT
+// Copyright 2021-2025 RnD Center "ELVEES", JSC
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <flash.h>
+#include <qspi.h>
+
+#define SR1_BUSY 0x1
+
+#define FLASH_READ     0x3
+#define FLASH_READ4    0x13
+#define FLASH_PROGRAM  0x2
+#define FLASH_PROGRAM4 0x12
+#define FLASH_ERASE    0xd8
+#define FLASH_ERASE4   0xdc
+
+int qspi_flash_fill_cmd_addr(uint8_t *buf, uint8_t cmd24, uint8_t cmd32, uint32_t addr)
+{
+	int addr_bytes;
+
+	if (addr >> 24) {
+		buf[0] = cmd32;
+		addr_bytes = 4;
+	} else {
+		buf[0] = cmd24;
+		addr_bytes = 3;
+	}
+
+	for (int i = 1; i <= addr_bytes; i++)
+		buf[i] = (addr >> ((addr_bytes - i) * 8)) & 0xff;
+
+	return addr_bytes + 1;
+}
+
+void qspi_flash_read(struct qspi *qspi, void *buf, int len, uint32_t offset)
+{
+	uint8_t tmp_buf[5];
+	int buf_len = qspi_flash_fill_cmd_addr(tmp_buf, FLASH_READ, FLASH_READ4, offset);
+
+	qspi_xfer(qspi, tmp_buf, NULL, buf_len, false);
+	qspi_xfer(qspi, NULL, buf, len, true);
+}
+
+void qspi_flash_write_enable(struct qspi *qspi)
+{
+	uint8_t data = 0x6;
+
+	qspi_xfer(qspi, &data, NULL, 1, true);
+}
+
+void qspi_flash_write_disable(struct qspi *qspi)
+{
+	uint8_t data = 0x4;
+
+	qspi_xfer(qspi, &data, NULL, 1, true);
+}
+
+uint8_t qspi_flash_read_status1(struct qspi *qspi)
+{
+	uint8_t cmd = 0x5;
+	uint8_t res;
+
+	qspi_xfer(qspi, &cmd, NULL, 1, false);
+	qspi_xfer(qspi, NULL, &res, 1, true);
+
+	return res;
+}
+
+bool qspi_flash_is_busy(struct qspi *qspi)
+{
+	return qspi_flash_read_status1(qspi) & SR1_BUSY;
+}
+
+void qspi_flash_wait_ready(struct qspi *qspi)
+{
+	while (qspi_flash_is_busy(qspi)) {
+	}
+}
+
+void qspi_flash_erase_start(struct qspi *qspi, uint32_t offset)
+{
+	uint8_t data[5];
+	int buf_len = qspi_flash_fill_cmd_addr(data, FLASH_ERASE, FLASH_ERASE4, offset);
+
+	qspi_xfer(qspi, &data, NULL, buf_len, true);
+}
+
+void qspi_flash_erase(struct qspi *qspi, uint32_t offset)
+{
+	qspi_flash_erase_start(qspi, offset);
+	qspi_flash_wait_ready(qspi);
+}
+
+void qspi_flash_write_page_start(struct qspi *qspi, void *buf, uint32_t len, uint32_t offset)
+{
+	uint8_t tmp_buf[5];
+	int buf_len;
+
+	buf_len = qspi_flash_fill_cmd_addr(tmp_buf, FLASH_PROGRAM, FLASH_PROGRAM4, offset);
+	qspi_xfer(qspi, tmp_buf, NULL, buf_len, false);
+	qspi_xfer(qspi, buf, NULL, len, true);
+}
+
+void qspi_flash_write_page(struct qspi *qspi, void *buf, uint32_t len, uint32_t offset)
+{
+	qspi_flash_write_page_start(qspi, buf, len, offset);
+	qspi_flash_wait_ready(qspi);
+}
@@ -0,0 +1,40 @@
+// SPDX-License-Identifier: MIT
+// Copyright 2021-2025 RnD Center "ELVEES", JSC
+
+#ifndef FLASH_H_
+#define FLASH_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <qspi.h>
+
+/* Write command and address to the buffer.
+ * buf - buffer for filling. Must be 5 bytes length.
+ * cmd24 - command for 24-bit addressing.
+ * cmd32 - command for 32-bit addressing.
+ * addr - address of data in SPI Flash.
+ * Return count of filled bytes (4 or 5).
+ */
+int qspi_flash_fill_cmd_addr(uint8_t *buf, uint8_t cmd24, uint8_t cmd32, uint32_t addr);
+
+void qspi_flash_read(struct qspi *qspi, void *buf, int len, uint32_t offset);
+void qspi_flash_write_enable(struct qspi *qspi);
+void qspi_flash_write_disable(struct qspi *qspi);
+uint8_t qspi_flash_read_status1(struct qspi *qspi);
+
+/* Return true while erase or program operation is in progress */
+bool qspi_flash_is_busy(struct qspi *qspi);
+void qspi_flash_wait_ready(struct qspi *qspi);
+
+/* Functions with _start suffix only send the command to SPI Flash and do not wait for the end
+ * of operation. It allows to do other work (for example, to access other controller) while
+ * SPI Flash is busy. Use qspi_flash_is_busy() or qspi_flash_wait_ready() to wait for the end
+ * of operation. Write must be enabled by qspi_flash_write_enable() before each operation.
+ */
+void qspi_flash_erase_start(struct qspi *qspi, uint32_t offset);
+void qspi_flash_erase(struct qspi *qspi, uint32_t offset);
+void qspi_flash_write_page_start(struct qspi *qspi, void *buf, uint32_t len, uint32_t offset);
+void qspi_flash_write_page(struct qspi *qspi, void *buf, uint32_t len, uint32_t offset);
+
+#endif
@@ -6,8 +6,13 @@
 #include <stdint.h>
 
 #include <clk.h>
+#include <compress.h>
 #include <console.h>
+#include <crc16.h>
 #include <delay.h>
+#include <eeprom.h>
+#include <fec.h>
+#include <flash.h>
 #include <gpio.h>
 #include <i2c.h>
 #include <qspi.h>
@@ -23,38 +28,78 @@
 /* Turn A into a string literal after macro-expanding it. */
 #define STRINGIZE(A) STRINGIZE_NX(A)
 
-#define SR1_BUSY 0x1
-
-#define FLASH_READ     0x3
-#define FLASH_READ4    0x13
-#define FLASH_PROGRAM  0x2
-#define FLASH_PROGRAM4 0x12
-#define FLASH_ERASE    0xd8
-#define FLASH_ERASE4   0xdc
-
 #define APP_NAME \
 	"QSPI Flasher (commit: '" STRINGIZE(GIT_SHA1_SHORT) "', build: '" STRINGIZE(BUILD_ID) "')"
 
 #define I2C_BUFFER_SIZE 256
 
+#define EEPROM_BLOCK_SIZE 1024
+
+#define I2C_BATCH_SIZE	    1024
+#define I2C_BATCH_STEPS_MAX 128
+
+#define SPI_XFER_SIZE		 1024
+#define SPI_XFER_FULL_DUPLEX BIT(0)
+#define SPI_XFER_KEEP_SS     BIT(1)
+
+#define CLONE_PAGE_SIZE	  256
+#define CLONE_SECTOR_SIZE 0x10000
+
+#define LANES_MAX 4
+
+#define RPC_ERR_FAILED CONSOLE_RPC_ERR_APP
+
+enum lane_state {
+	LANE_HEADER,
+	LANE_PAYLOAD,
+	LANE_FULL,
+};
+
+/* State of one UART used to receive frames in write_multi mode */
+struct lane {
+	struct uart *uart;
+	enum lane_state state;
+	uint8_t header[6];
+	uint32_t pos;
+	uint16_t seq;
+	uint16_t len;
+	uint16_t crc;
+	uint8_t *buf;
+};
+
+/* Command ids are also RPC ids (see README), so values are fixed: never reorder or reuse them,
+ * only append new commands to the end.
+ */
 enum cmd_ids {
-	CMD_HELP,
-	CMD_BAUDRATE,
-	CMD_QSPI,
-	CMD_ERASE,
-	CMD_WRITE,
-	CMD_READ,
-	CMD_READ_CRC,
-	CMD_CUSTOM,
-	CMD_BOOTROM,
-	CMD_EXIT,
-	CMD_I2C_DEV,
-	CMD_I2C_READ,
-	CMD_I2C_WRITE,
+	CMD_HELP = 0,
+	CMD_BAUDRATE = 1,
+	CMD_QSPI = 2,
+	CMD_ERASE = 3,
+	CMD_WRITE = 4,
+	CMD_READ = 5,
+	CMD_READ_CRC = 6,
+	CMD_CUSTOM = 7,
+	CMD_BOOTROM = 8,
+	CMD_EXIT = 9,
+	CMD_I2C_DEV = 10,
+	CMD_I2C_READ = 11,
+	CMD_I2C_WRITE = 12,
+	CMD_WRITE_MEM = 13,
+	CMD_VERIFY_MEM = 14,
+	CMD_CLONE = 15,
+	CMD_MIRROR = 16,
+	CMD_WRITE_MULTI = 17,
+	CMD_FEC = 18,
+	CMD_EEPROM_WRITE = 19,
+	CMD_EEPROM_READ = 20,
+	CMD_I2C_BATCH = 21,
+	CMD_SPI_XFER = 22,
 };
 
 bool need_exit;
 struct qspi *qspi;
+struct qspi *qspi_mirror;
+bool fec_enabled;
 struct i2c *i2c;
 struct console_cmd console_cmd[] = {
 	{
@@ -99,7 +144,7 @@ struct console_cmd console_cmd[] = {
 	{
 		.cmd_id = CMD_READ,
 		.cmd = "read",
-		.help = "read data from SPI flash: read <offset> <size> [text|bin]",
+		.help = "read data from SPI flash: read <offset> <size> [text|bin|lz]",
 		.arg_min = 2,
 		.arg_max = 3,
 		.arg_types = { ARG_UINT, ARG_UINT, ARG_STR },
@@ -120,6 +165,38 @@ struct console_cmd console_cmd[] = {
 		.arg_max = 2,
 		.arg_types = { ARG_STR, ARG_UINT },
 	},
+	{
+		.cmd_id = CMD_SPI_XFER,
+		.cmd = "spi_xfer",
+		.help = "run SPI transactions (required binary data): spi_xfer",
+		.arg_min = 0,
+		.arg_max = 0,
+	},
+	{
+		.cmd_id = CMD_CLONE,
+		.cmd = "clone",
+		.help = "copy data from one SPI flash to another: "
+			"clone <src_qspi> <dst_qspi> <offset> <size>",
+		.arg_min = 4,
+		.arg_max = 4,
+		.arg_types = { ARG_UINT, ARG_UINT, ARG_UINT, ARG_UINT },
+	},
+	{
+		.cmd_id = CMD_MIRROR,
+		.cmd = "mirror",
+		.help = "duplicate erase and write to second QSPI controller: mirror <0|1>",
+		.arg_min = 1,
+		.arg_max = 1,
+		.arg_types = { ARG_UINT },
+	},
+	{
+		.cmd_id = CMD_FEC,
+		.cmd = "fec",
+		.help = "enable error correction codes for write and binary read: fec <0|1>",
+		.arg_min = 1,
+		.arg_max = 1,
+		.arg_types = { ARG_UINT },
+	},
 #ifdef MIPS32
 	{
 		.cmd_id = CMD_BOOTROM,
@@ -137,12 +214,38 @@ struct console_cmd console_cmd[] = {
 		.arg_min = 0,
 		.arg_max = 0,
 	},
+	{
+		.cmd_id = CMD_WRITE_MULTI,
+		.cmd = "write_multi",
+		.help = "turn to write mode with data received from several UARTs: "
+			"write_multi <offset> <page_size> <uart_mask>",
+		.arg_min = 3,
+		.arg_max = 3,
+		.arg_types = { ARG_UINT, ARG_UINT, ARG_UINT },
+	},
+	{
+		.cmd_id = CMD_WRITE_MEM,
+		.cmd = "write_mem",
+		.help = "write data from memory to SPI flash: "
+			"write_mem <offset> <mem_addr> <size> [page_size]",
+		.arg_min = 3,
+		.arg_max = 4,
+		.arg_types = { ARG_UINT, ARG_ADDR, ARG_UINT, ARG_UINT },
+	},
+	{
+		.cmd_id = CMD_VERIFY_MEM,
+		.cmd = "verify_mem",
+		.help = "compare SPI flash with data in memory: verify_mem <offset> <mem_addr> <size>",
+		.arg_min = 3,
+		.arg_max = 3,
+		.arg_types = { ARG_UINT, ARG_ADDR, ARG_UINT },
+	},
 #endif
 	{
 		.cmd_id = CMD_I2C_DEV,
 		.cmd = "i2c_dev",
 		.help = "Select and prepare I2C controller: "
-			"i2c_dev <ctrl_id> <speed> (0 - std, 1 - fast)",
+			"i2c_dev <ctrl_id> <speed> (0 - std, 1 - fast, otherwise speed in Hz)",
 		.arg_min = 2,
 		.arg_max = 2,
 		.arg_types = { ARG_UINT, ARG_UINT },
@@ -163,6 +266,30 @@ struct console_cmd console_cmd[] = {
 		.arg_max = 4,
 		.arg_types = { ARG_UINT, ARG_UINT, ARG_UINT, ARG_UINT },
 	},
+	{
+		.cmd_id = CMD_I2C_BATCH,
+		.cmd = "i2c_batch",
+		.help = "Run lists of I2C transfers (required binary data): i2c_batch",
+		.arg_min = 0,
+		.arg_max = 0,
+	},
+	{
+		.cmd_id = CMD_EEPROM_WRITE,
+		.cmd = "eeprom_write",
+		.help = "Write data to I2C EEPROM (required binary data): "
+			"eeprom_write <addr> <alen> <page_size> <offset>",
+		.arg_min = 4,
+		.arg_max = 4,
+		.arg_types = { ARG_UINT, ARG_UINT, ARG_UINT, ARG_UINT },
+	},
+	{
+		.cmd_id = CMD_EEPROM_READ,
+		.cmd = "eeprom_read",
+		.help = "Read data from I2C EEPROM: eeprom_read <addr> <alen> <offset> <size> [text|bin]",
+		.arg_min = 4,
+		.arg_max = 5,
+		.arg_types = { ARG_UINT, ARG_UINT, ARG_UINT, ARG_UINT, ARG_STR },
+	},
 };
 
 unsigned long __stack_chk_guard;
@@ -282,137 +409,163 @@ int qspi_prepare(int id, int v18)
 		return -1;
 
 	qspi_init(qspi, 0);
+	if (qspi_mirror) {
+		qspi_mirror = qspi == QSPI0 ? QSPI1 : QSPI0;
+		qspi_init(qspi_mirror, 0);
+	}
 
 	return 0;
 }
 
-/* Write command and address to the buffer.
- * buf - buffer for filling. Must be 5 bytes length.
- * cmd24 - command for 24-bit addressing.
- * cmd32 - command for 32-bit addressing.
- * addr - address of data in SPI Flash.
- * Return count of filled bytes (4 or 5).
+/* Enable or disable mirror mode. In mirror mode erase and write operations are applied
+ * to both QSPI controllers: to the active one and to the other one.
  */
-int qspi_flash_fill_cmd_addr(uint8_t *buf, uint8_t cmd24, uint8_t cmd32, uint32_t addr)
+void mirror_prepare(int enable)
 {
-	int addr_bytes;
+	if (enable) {
+		qspi_mirror = qspi == QSPI0 ? QSPI1 : QSPI0;
+		qspi_init(qspi_mirror, 0);
+	} else
+		qspi_mirror = NULL;
+}
 
-	if (addr >> 24) {
-		buf[0] = cmd32;
-		addr_bytes = 4;
-	} else {
-		buf[0] = cmd24;
-		addr_bytes = 3;
+/* Erase sector on active SPI flash and on mirror SPI flash (if enabled).
+ * Both flashes erase the sector at the same time.
+ */
+static void flash_erase(uint32_t offset)
+{
+	qspi_flash_write_enable(qspi);
+	qspi_flash_erase_start(qspi, offset);
+	if (qspi_mirror) {
+		qspi_flash_write_enable(qspi_mirror);
+		qspi_flash_erase_start(qspi_mirror, offset);
 	}
 
-	for (int i = 1; i <= addr_bytes; i++)
-		buf[i] = (addr >> ((addr_bytes - i) * 8)) & 0xff;
-
-	return addr_bytes + 1;
+	qspi_flash_wait_ready(qspi);
+	if (qspi_mirror)
+		qspi_flash_wait_ready(qspi_mirror);
 }
 
-void qspi_flash_read(void *buf, int len, uint32_t offset)
+/* Start page programming on active SPI flash and on mirror SPI flash (if enabled).
+ * Data is already transferred to the flashes on return, so buffer can be reused.
+ */
+static void flash_write_page_start(void *buf, uint32_t len, uint32_t offset)
 {
-	uint8_t tmp_buf[5];
-	int buf_len = qspi_flash_fill_cmd_addr(tmp_buf, FLASH_READ, FLASH_READ4, offset);
-
-	qspi_xfer(qspi, tmp_buf, NULL, buf_len, false);
-	qspi_xfer(qspi, NULL, buf, len, true);
+	qspi_flash_write_enable(qspi);
+	qspi_flash_write_page_start(qspi, buf, len, offset);
+	if (qspi_mirror) {
+		qspi_flash_write_enable(qspi_mirror);
+		qspi_flash_write_page_start(qspi_mirror, buf, len, offset);
+	}
 }
 
-void qspi_flash_write_enable(void)
+static void flash_wait_ready(void)
 {
-	uint8_t data = 0x6;
-
-	qspi_xfer(qspi, &data, NULL, 1, true);
+	qspi_flash_wait_ready(qspi);
+	if (qspi_mirror)
+		qspi_flash_wait_ready(qspi_mirror);
 }
 
-void qspi_flash_write_disable(void)
+/* Program page on active SPI flash and on mirror SPI flash (if enabled).
+ * Both flashes program the page at the same time.
+ */
+static void flash_write_page(void *buf, uint32_t len, uint32_t offset)
 {
-	uint8_t data = 0x4;
-
-	qspi_xfer(qspi, &data, NULL, 1, true);
+	flash_write_page_start(buf, len, offset);
+	flash_wait_ready();
 }
 
-uint8_t qspi_flash_read_status1(void)
+static uint16_t iface_read_crc(uint32_t offset, uint32_t size)
 {
-	uint8_t cmd = 0x5;
-	uint8_t res;
+	uint8_t buf[1024];
+	uint16_t crc = crc16_init();
+	uint32_t len;
+
+	while (size) {
+		len = size > sizeof(buf) ? sizeof(buf) : size;
+		qspi_flash_read(qspi, buf, len, offset);
+		for (unsigned i = 0; i < len; i++)
+			crc = crc16_update_byte(crc, buf[i]);
 
-	qspi_xfer(qspi, &cmd, NULL, 1, false);
-	qspi_xfer(qspi, NULL, &res, 1, true);
+		size -= len;
+		offset += len;
+	}
 
-	return res;
+	return crc;
 }
 
-void qspi_flash_erase(uint32_t offset)
+/* Receive data protected by FEC. Syndromes are calculated while data is being received,
+ * so decoding is only needed for corrupted segments.
+ * Return false if some segment can not be corrected.
+ */
+static bool uart_read_fec(uint8_t *buf, uint32_t len)
 {
-	uint8_t data[5];
-	int buf_len = qspi_flash_fill_cmd_addr(data, FLASH_ERASE, FLASH_ERASE4, offset);
+	uint8_t synd[FEC_PARITY];
+	uint8_t parity[FEC_PARITY];
+	bool is_ok = true;
 
-	qspi_xfer(qspi, &data, NULL, buf_len, true);
+	while (len) {
+		uint32_t n = len > FEC_SEGMENT_SIZE ? FEC_SEGMENT_SIZE : len;
 
-	while (qspi_flash_read_status1() & SR1_BUSY) {
-	}
-}
+		fec_syndromes_init(synd);
+		for (uint32_t i = 0; i < n; i++) {
+			buf[i] = uart_getchar(UART0);
+			fec_syndromes_update(synd, buf[i]);
+		}
+		for (int i = 0; i < FEC_PARITY; i++) {
+			parity[i] = uart_getchar(UART0);
+			fec_syndromes_update(synd, parity[i]);
+		}
 
-void qspi_flash_write_page(void *buf, uint32_t len, uint32_t offset)
-{
-	uint8_t tmp_buf[5];
-	int buf_len;
+		if (fec_correct(buf, n, parity, synd) < 0)
+			is_ok = false;
 
-	buf_len = qspi_flash_fill_cmd_addr(tmp_buf, FLASH_PROGRAM, FLASH_PROGRAM4, offset);
-	qspi_xfer(qspi, tmp_buf, NULL, buf_len, false);
-	qspi_xfer(qspi, buf, NULL, len, true);
-	while (qspi_flash_read_status1() & SR1_BUSY) {
+		buf += n;
+		len -= n;
 	}
-}
 
-static uint16_t crc16_init(void)
-{
-	return 0xffff;
+	return is_ok;
 }
 
-static uint16_t crc16_update_byte(uint16_t crc, uint8_t data)
+/* Send data with FEC parity bytes after each segment */
+static void uart_write_fec(uint8_t *buf, uint32_t len)
 {
-	crc ^= (uint16_t)data << 8;
-	for (int i = 0; i < 8; i++)
-		crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+	uint8_t parity[FEC_PARITY];
 
-	return crc;
-}
+	while (len) {
+		uint32_t n = len > FEC_SEGMENT_SIZE ? FEC_SEGMENT_SIZE : len;
 
-static uint16_t iface_read_crc(uint32_t offset, uint32_t size)
-{
-	uint8_t buf[1024];
-	uint16_t crc = crc16_init();
-	uint32_t len;
+		fec_encode(buf, n, parity);
+		for (uint32_t i = 0; i < n; i++)
+			uart_putc_raw(UART0, buf[i]);
 
-	while (size) {
-		len = size > sizeof(buf) ? sizeof(buf) : size;
-		qspi_flash_read(buf, len, offset);
-		for (unsigned i = 0; i < len; i++)
-			crc = crc16_update_byte(crc, buf[i]);
+		for (int i = 0; i < FEC_PARITY; i++)
+			uart_putc_raw(UART0, parity[i]);
 
-		size -= len;
-		offset += len;
+		buf += n;
+		len -= n;
 	}
-
-	return crc;
 }
 
 void iface_write_data(uint32_t offset, uint32_t size)
 {
+	uint8_t header[4];
 	uint16_t block_size;
 	uint16_t expected_crc;
 	uint16_t crc;
 	uint8_t buf[size];
 
 	while (1) {
-		block_size = uart_getchar(UART0);
-		block_size |= (uint16_t)uart_getchar(UART0) << 8;
-		expected_crc = uart_getchar(UART0);
-		expected_crc |= (uint16_t)uart_getchar(UART0) << 8;
+		if (!fec_enabled) {
+			for (unsigned i = 0; i < sizeof(header); i++)
+				header[i] = uart_getchar(UART0);
+		} else if (!uart_read_fec(header, sizeof(header))) {
+			uart_puts(UART0, "E\nUncorrectable block header\n");
+			return;
+		}
+
+		block_size = header[0] | ((uint16_t)header[1] << 8);
+		expected_crc = header[2] | ((uint16_t)header[3] << 8);
 		if (!block_size) {
 			uart_putc(UART0, '\n');
 			return;
@@ -421,22 +574,174 @@ void iface_write_data(uint32_t offset, uint32_t size)
 			return;
 		}
 		crc = crc16_init();
-		for (unsigned i = 0; i < block_size; i++) {
-			buf[i] = uart_getchar(UART0);
-			crc = crc16_update_byte(crc, buf[i]);
+		if (fec_enabled) {
+			if (!uart_read_fec(buf, block_size)) {
+				uart_putc(UART0, 'C');
+				continue;
+			}
+			for (unsigned i = 0; i < block_size; i++)
+				crc = crc16_update_byte(crc, buf[i]);
+		} else {
+			for (unsigned i = 0; i < block_size; i++) {
+				buf[i] = uart_getchar(UART0);
+				crc = crc16_update_byte(crc, buf[i]);
+			}
 		}
 
 		if (crc != expected_crc) {
 			uart_putc(UART0, 'C');
 			continue;
 		}
-		qspi_flash_write_enable();
-		qspi_flash_write_page(buf, block_size, offset);
+		flash_write_page(buf, block_size, offset);
 		offset += block_size;
 		uart_putc(UART0, 'R');
 	}
 }
 
+#ifdef CAN_RETURN
+static bool flash_is_busy(void)
+{
+	if (qspi_flash_is_busy(qspi))
+		return true;
+
+	return qspi_mirror && qspi_flash_is_busy(qspi_mirror);
+}
+
+/* Receive available bytes from lane UART without blocking.
+ * When frame is received completely and its CRC is correct, lane goes to LANE_FULL state.
+ * Frame with wrong CRC is dropped and 'C' is sent to the lane.
+ * Return -1 if frame is too large, otherwise return 0.
+ */
+static int lane_poll(struct lane *lane, uint32_t page_size)
+{
+	while (lane->state != LANE_FULL && uart_is_char_ready(lane->uart)) {
+		uint8_t ch = uart_getchar(lane->uart);
+
+		if (lane->state == LANE_HEADER) {
+			lane->header[lane->pos++] = ch;
+			if (lane->pos < sizeof(lane->header))
+				continue;
+
+			lane->seq = lane->header[0] | ((uint16_t)lane->header[1] << 8);
+			lane->len = lane->header[2] | ((uint16_t)lane->header[3] << 8);
+			if (lane->len > page_size)
+				return -1;
+
+			lane->crc = crc16_init();
+			for (int i = 0; i < 4; i++)
+				lane->crc = crc16_update_byte(lane->crc, lane->header[i]);
+
+			lane->pos = 0;
+			lane->state = lane->len ? LANE_PAYLOAD : LANE_FULL;
+		} else {
+			lane->buf[lane->pos++] = ch;
+			lane->crc = crc16_update_byte(lane->crc, ch);
+			if (lane->pos == lane->len)
+				lane->state = LANE_FULL;
+		}
+
+		if (lane->state == LANE_FULL &&
+		    lane->crc != (lane->header[4] | ((uint16_t)lane->header[5] << 8))) {
+			uart_putc(lane->uart, 'C');
+			lane->state = LANE_HEADER;
+			lane->pos = 0;
+		}
+	}
+
+	return 0;
+}
+
+/* Write data received from several UARTs (lanes) at once. Host sends frames to lanes
+ * in round-robin order, each frame has a sequence number. Frames are programmed in order
+ * of sequence numbers, so a lane keeps its frame until all previous frames are programmed.
+ * Lanes are polled all the time including the time while SPI flash is busy.
+ * Clocks, pads and baud rate of UART1-UART3 are not set up here, they are used as configured
+ * by U-Boot.
+ */
+static void iface_write_multi(uint32_t offset, uint32_t page_size, uint32_t uart_mask)
+{
+	struct uart *uarts[LANES_MAX] = { UART0, UART1, UART2, UART3 };
+	struct lane lanes[LANES_MAX];
+	uint16_t next_seq = 0;
+	bool is_busy = false;
+	int count = 0;
+	int i;
+
+	for (i = 0; i < LANES_MAX; i++) {
+		if (uart_mask & BIT(i))
+			count++;
+	}
+
+	if (!count || uart_mask >= BIT(LANES_MAX)) {
+		uart_puts(UART0, "E\nWrong UART mask\n");
+		return;
+	}
+
+	if (page_size == 0 || page_size * count > 32 * 1024) {
+		uart_puts(UART0, "E\nWrong page size. Must be 0 < page * lanes <= 32768\n");
+		return;
+	}
+
+	uint8_t buf[count][page_size];
+
+	count = 0;
+	for (i = 0; i < LANES_MAX; i++) {
+		if (!(uart_mask & BIT(i)))
+			continue;
+
+		lanes[count].uart = uarts[i];
+		lanes[count].state = LANE_HEADER;
+		lanes[count].pos = 0;
+		lanes[count].buf = buf[count];
+		if (i)
+			uart_clear_input_buffer(uarts[i]);
+
+		count++;
+	}
+
+	uart_puts(UART0, "Ready for data\n#");
+	while (1) {
+		for (i = 0; i < count; i++) {
+			if (lane_poll(&lanes[i], page_size)) {
+				if (is_busy)
+					flash_wait_ready();
+
+				uart_puts(lanes[i].uart, "E\nBlock size is too large\n");
+				return;
+			}
+		}
+
+		if (is_busy) {
+			if (flash_is_busy())
+				continue;
+
+			is_busy = false;
+		}
+
+		for (i = 0; i < count; i++) {
+			if (lanes[i].state == LANE_FULL && lanes[i].seq == next_seq)
+				break;
+		}
+
+		if (i == count)
+			continue;
+
+		if (!lanes[i].len) {
+			uart_putc(lanes[i].uart, '\n');
+			return;
+		}
+
+		flash_write_page_start(lanes[i].buf, lanes[i].len, offset);
+		is_busy = true;
+		offset += lanes[i].len;
+		next_seq++;
+		lanes[i].state = LANE_HEADER;
+		lanes[i].pos = 0;
+		uart_putc(lanes[i].uart, 'R');
+	}
+}
+#endif
+
 static inline uint32_t hexchar2uint(char ch)
 {
 	if (ch >= '0' && ch <= '9')
@@ -515,6 +820,100 @@ static void iface_custom(char *tx_str, uint32_t size)
 	uart_putc(UART0, '\n');
 }
 
+/* Run SPI transaction described by request: | flags | rx_len_lo | rx_len_hi | tx_data |.
+ * tx_data is transmitted, then rx_len bytes are received. If SPI_XFER_FULL_DUPLEX flag is set
+ * then data received while tx_data is transmitted is also returned (before rx_len bytes).
+ * If SPI_XFER_KEEP_SS flag is set then SS is not deasserted and the next request continues
+ * the transaction.
+ * Return size of reply or -1 if request is malformed.
+ */
+static int spi_xfer_run(uint8_t *req, uint32_t req_len, uint8_t *reply, uint32_t reply_size)
+{
+	uint32_t tx_len, rx_len, flags;
+	uint32_t pos = 0;
+
+	if (req_len < 3)
+		return -1;
+
+	flags = req[0];
+	rx_len = req[1] | ((uint32_t)req[2] << 8);
+	tx_len = req_len - 3;
+	if (rx_len + ((flags & SPI_XFER_FULL_DUPLEX) ? tx_len : 0) > reply_size)
+		return -1;
+
+	if (tx_len) {
+		qspi_xfer(qspi, &req[3], (flags & SPI_XFER_FULL_DUPLEX) ? reply : NULL, tx_len,
+			  !rx_len && !(flags & SPI_XFER_KEEP_SS));
+		if (flags & SPI_XFER_FULL_DUPLEX)
+			pos = tx_len;
+	}
+	if (rx_len)
+		qspi_xfer(qspi, NULL, &reply[pos], rx_len, !(flags & SPI_XFER_KEEP_SS));
+
+	return pos + rx_len;
+}
+
+/* Receive SPI transactions and run them. Request blocks have the same format as blocks of
+ * write command. Each valid block is answered by 'R' and the reply block:
+ * | len_lo | len_hi | crc_lo | crc_hi | rx_data |.
+ */
+static void iface_spi_xfer(void)
+{
+	uint8_t req[SPI_XFER_SIZE + 3];
+	uint8_t reply[SPI_XFER_SIZE];
+	uint16_t block_size;
+	uint16_t expected_crc;
+	uint16_t crc;
+	int len;
+
+	uart_puts(UART0, "Ready for data\n#");
+	while (1) {
+		block_size = uart_getchar(UART0);
+		block_size |= (uint16_t)uart_getchar(UART0) << 8;
+		expected_crc = uart_getchar(UART0);
+		expected_crc |= (uint16_t)uart_getchar(UART0) << 8;
+		if (!block_size) {
+			qspi_deassert_ss(qspi);
+			uart_putc(UART0, '\n');
+			return;
+		} else if (block_size > sizeof(req)) {
+			qspi_deassert_ss(qspi);
+			uart_puts(UART0, "E\nBlock size is too large\n");
+			return;
+		}
+
+		crc = crc16_init();
+		for (unsigned i = 0; i < block_size; i++) {
+			req[i] = uart_getchar(UART0);
+			crc = crc16_update_byte(crc, req[i]);
+		}
+
+		if (crc != expected_crc) {
+			uart_putc(UART0, 'C');
+			continue;
+		}
+
+		len = spi_xfer_run(req, block_size, reply, sizeof(reply));
+		if (len < 0) {
+			qspi_deassert_ss(qspi);
+			uart_puts(UART0, "E\nWrong transaction\n");
+			return;
+		}
+
+		crc = crc16_init();
+		for (int i = 0; i < len; i++)
+			crc = crc16_update_byte(crc, reply[i]);
+
+		uart_putc(UART0, 'R');
+		uart_putc_raw(UART0, len & 0xff);
+		uart_putc_raw(UART0, len >> 8);
+		uart_putc_raw(UART0, crc & 0xff);
+		uart_putc_raw(UART0, crc >> 8);
+		for (int i = 0; i < len; i++)
+			uart_putc_raw(UART0, reply[i]);
+	}
+}
+
 int strcmp(char *s1, char *s2)
 {
 	while (*s1 || *s2) {
@@ -565,6 +964,48 @@ static void print_hexdump_body(uint8_t *buf, uint32_t offset, uint32_t len)
 	}
 }
 
+/* Send data as frames of compressed chunks. Frame structure is the same as for block of
+ * write command: | len_lo | len_hi | crc_lo | crc_hi | payload |, where `payload` is compressed
+ * chunk and CRC16 is calculated over uncompressed data.
+ */
+static void iface_read_lz(uint32_t offset, uint32_t size)
+{
+	uint8_t buf[COMPRESS_CHUNK_SIZE];
+	uint8_t packed[COMPRESS_BOUND(COMPRESS_CHUNK_SIZE)];
+	uint8_t header[4];
+	uint16_t crc;
+
+	uart_putc(UART0, '#');
+	while (size) {
+		uint32_t len = size > sizeof(buf) ? sizeof(buf) : size;
+		uint32_t packed_len;
+
+		qspi_flash_read(qspi, buf, len, offset);
+		crc = crc16_init();
+		for (unsigned i = 0; i < len; i++)
+			crc = crc16_update_byte(crc, buf[i]);
+
+		packed_len = compress_chunk(buf, len, packed);
+		header[0] = packed_len & 0xff;
+		header[1] = packed_len >> 8;
+		header[2] = crc & 0xff;
+		header[3] = crc >> 8;
+		if (fec_enabled) {
+			uart_write_fec(header, sizeof(header));
+			uart_write_fec(packed, packed_len);
+		} else {
+			for (unsigned i = 0; i < sizeof(header); i++)
+				uart_putc_raw(UART0, header[i]);
+
+			for (unsigned i = 0; i < packed_len; i++)
+				uart_putc_raw(UART0, packed[i]);
+		}
+
+		size -= len;
+		offset += len;
+	}
+}
+
 static void iface_read(uint32_t offset, uint32_t size, char *mode)
 {
 	int mode_int;
@@ -576,15 +1017,20 @@ static void iface_read(uint32_t offset, uint32_t size, char *mode)
 	} else if (!strcmp(mode, "bin")) {
 		mode_int = 1;
 		uart_putc(UART0, '#');
+	} else if (!strcmp(mode, "lz")) {
+		iface_read_lz(offset, size);
+		return;
 	} else {
 		uart_puts(UART0, "Error: Unknown mode\n");
 		return;
 	}
 	while (size) {
 		uint32_t len = size > sizeof(buf) ? sizeof(buf) : size;
-		qspi_flash_read(buf, len, offset);
+		qspi_flash_read(qspi, buf, len, offset);
 		if (mode_int == 0) {
 			print_hexdump_body(buf, offset, len);
+		} else if (fec_enabled) {
+			uart_write_fec(buf, len);
 		} else {
 			for (unsigned i = 0; i < len; i++)
 				uart_putc_raw(UART0, buf[i]); // Do not add \r to \n
@@ -594,7 +1040,189 @@ static void iface_read(uint32_t offset, uint32_t size, char *mode)
 	}
 }
 
-void cmd_i2c_dev(uint32_t ctrl_id, uint32_t speed)
+static struct qspi *qspi_by_id(uint32_t id)
+{
+	if (id == 0)
+		return QSPI0;
+	else if (id == 1)
+		return QSPI1;
+
+	return NULL;
+}
+
+static bool is_erased_data(uint8_t *buf, uint32_t len)
+{
+	for (uint32_t i = 0; i < len; i++) {
+		if (buf[i] != 0xff)
+			return false;
+	}
+
+	return true;
+}
+
+/* Compare data of two SPI flashes.
+ * is_same - will be true if data in both flashes is the same
+ * is_erased - will be true if data in destination flash is erased
+ */
+static void clone_compare(struct qspi *src, struct qspi *dst, uint32_t offset, uint32_t size,
+			  bool *is_same, bool *is_erased)
+{
+	uint8_t src_buf[1024];
+	uint8_t dst_buf[1024];
+
+	*is_same = true;
+	*is_erased = true;
+	while (size && (*is_same || *is_erased)) {
+		uint32_t len = size > sizeof(dst_buf) ? sizeof(dst_buf) : size;
+
+		qspi_flash_read(dst, dst_buf, len, offset);
+		if (*is_erased)
+			*is_erased = is_erased_data(dst_buf, len);
+
+		if (*is_same) {
+			qspi_flash_read(src, src_buf, len, offset);
+			for (uint32_t i = 0; i < len && *is_same; i++)
+				*is_same = src_buf[i] == dst_buf[i];
+		}
+		size -= len;
+		offset += len;
+	}
+}
+
+/* Copy erased area page by page. The next page is read from the source flash while
+ * the destination flash programs previous one. Erased pages are skipped.
+ */
+static void clone_program(struct qspi *src, struct qspi *dst, uint32_t offset, uint32_t size)
+{
+	uint8_t buf[CLONE_PAGE_SIZE];
+	bool is_busy = false;
+
+	for (uint32_t pos = 0; pos < size; pos += CLONE_PAGE_SIZE) {
+		qspi_flash_read(src, buf, CLONE_PAGE_SIZE, offset + pos);
+		if (is_erased_data(buf, CLONE_PAGE_SIZE))
+			continue;
+
+		if (is_busy)
+			qspi_flash_wait_ready(dst);
+
+		qspi_flash_write_enable(dst);
+		qspi_flash_write_page_start(dst, buf, CLONE_PAGE_SIZE, offset + pos);
+		is_busy = true;
+	}
+	if (is_busy)
+		qspi_flash_wait_ready(dst);
+}
+
+/* Copy data from one SPI flash to another sector by sector. Sectors that already contain
+ * the same data are skipped. Sectors of destination flash are erased only if they are not
+ * erased yet. Each copied sector is verified. Sector size is equal to erase block size of
+ * qspi_flash_erase(), so erase never touches data outside of the current sector.
+ */
+static void iface_clone(uint32_t src_id, uint32_t dst_id, uint32_t offset, uint32_t size)
+{
+	const uint32_t sector_size = CLONE_SECTOR_SIZE;
+	struct qspi *src = qspi_by_id(src_id);
+	struct qspi *dst = qspi_by_id(dst_id);
+	uint32_t copied = 0;
+	uint32_t erased = 0;
+	uint32_t skipped = 0;
+	bool is_same;
+	bool is_erased;
+
+	if (!src || !dst || src == dst) {
+		uart_puts(UART0, "Error: Wrong QSPI controllers\n");
+		return;
+	}
+
+	if ((offset % sector_size) || (size % sector_size)) {
+		uart_puts(UART0, "Error: Offset and size must be aligned to sector size\n");
+		return;
+	}
+
+	qspi_init(src, 0);
+	qspi_init(dst, 0);
+	for (; size; size -= sector_size, offset += sector_size) {
+		clone_compare(src, dst, offset, sector_size, &is_same, &is_erased);
+		if (is_same) {
+			skipped++;
+			continue;
+		}
+
+		if (!is_erased) {
+			qspi_flash_write_enable(dst);
+			qspi_flash_erase(dst, offset);
+			erased++;
+		}
+
+		clone_program(src, dst, offset, sector_size);
+		clone_compare(src, dst, offset, sector_size, &is_same, &is_erased);
+		if (!is_same) {
+			uart_printf(UART0, "Error: Verification failed for sector at offset %#x\n",
+				    offset);
+			return;
+		}
+		copied++;
+	}
+	uart_printf(UART0, "OK: %d sectors copied (%d erased), %d sectors already equal\n",
+		    copied, erased, skipped);
+}
+
+#ifdef CAN_RETURN
+/* Program SPI flash with data placed in memory (for example, by U-Boot).
+ * Data is written page by page, pages filled with 0xff are skipped because erased flash
+ * already contains them.
+ */
+static void iface_write_mem(uint32_t offset, uintptr_t mem_addr, uint32_t size,
+			    uint32_t page_size)
+{
+	uint8_t *src = (uint8_t *)mem_addr;
+	uint32_t len;
+
+	if (page_size == 0 || page_size > 32 * 1024) {
+		uart_puts(UART0, "Error: Wrong page size. Must be 0 < page <= 32768\n");
+		return;
+	}
+
+	while (size) {
+		len = page_size - offset % page_size;
+		if (len > size)
+			len = size;
+
+		if (!is_erased_data(src, len))
+			flash_write_page(src, len, offset);
+		src += len;
+		offset += len;
+		size -= len;
+	}
+	uart_puts(UART0, "OK\n");
+}
+
+static void iface_verify_mem(uint32_t offset, uintptr_t mem_addr, uint32_t size)
+{
+	uint8_t *expected = (uint8_t *)mem_addr;
+	uint8_t buf[1024];
+
+	while (size) {
+		uint32_t len = size > sizeof(buf) ? sizeof(buf) : size;
+
+		qspi_flash_read(qspi, buf, len, offset);
+		for (uint32_t i = 0; i < len; i++) {
+			if (buf[i] != expected[i]) {
+				uart_printf(UART0, "Error: Mismatch at offset %#x (%#x != %#x)\n",
+					    offset + i, buf[i], expected[i]);
+				return;
+			}
+		}
+		expected += len;
+		offset += len;
+		size -= len;
+	}
+	uart_puts(UART0, "OK\n");
+}
+#endif
+
+/* Return achieved speed in Hz or 0 on error */
+uint32_t cmd_i2c_dev(uint32_t ctrl_id, uint32_t speed)
 {
 	switch (ctrl_id) {
 	case 0:
@@ -614,7 +1242,7 @@ void cmd_i2c_dev(uint32_t ctrl_id, uint32_t speed)
 		break;
 	default:
 		uart_printf(UART0, "Error: wrong ctrl_id %d\n", ctrl_id);
-		return;
+		return 0;
 	}
 
 	if (speed == 0)
@@ -622,8 +1250,10 @@ void cmd_i2c_dev(uint32_t ctrl_id, uint32_t speed)
 	else if (speed == 1)
 		speed = I2C_FAST_SPEED;
 
-	i2c_init(i2c, speed, XTI_FREQUENCY);
+	speed = i2c_init(i2c, speed, XTI_FREQUENCY);
 	i2c_pads_cfg(ctrl_id);
+
+	return speed;
 }
 
 void cmd_i2c_read(uint32_t addr, uint32_t regaddr, uint32_t alen, uint32_t size, char *mode)
@@ -672,9 +1302,248 @@ void cmd_i2c_write(uint32_t addr, uint32_t regaddr, uint32_t alen, uint32_t size
 	uart_puts(UART0, "Done\n");
 }
 
+/* Parse list of I2C steps and run it as one session.
+ * Request is a sequence of steps: | type | flags | addr | len_lo | len_hi | data |, where data
+ * is present only for write steps (see struct i2c_step).
+ * Reply contains status of each step (1 - success, 0 - error) followed by data of all read steps.
+ * Return size of reply or -1 if request is malformed.
+ */
+static int i2c_batch_run(uint8_t *req, uint32_t req_len, uint8_t *reply, uint32_t reply_size)
+{
+	struct i2c_step steps[I2C_BATCH_STEPS_MAX];
+	uint32_t read_size = 0;
+	uint32_t count = 0;
+	uint32_t pos = 0;
+
+	while (pos < req_len) {
+		struct i2c_step *step = &steps[count];
+
+		if (count == ARRAY_LENGTH(steps) || pos + 5 > req_len)
+			return -1;
+
+		step->type = req[pos];
+		step->flags = req[pos + 1];
+		step->addr = req[pos + 2];
+		step->len = req[pos + 3] | ((uint32_t)req[pos + 4] << 8);
+		pos += 5;
+		if (step->type == I2C_STEP_WRITE) {
+			if (pos + step->len > req_len)
+				return -1;
+
+			step->buf = &req[pos];
+			pos += step->len;
+		} else if (step->type == I2C_STEP_READ) {
+			read_size += step->len;
+		} else if (step->type != I2C_STEP_DELAY) {
+			return -1;
+		}
+		count++;
+	}
+
+	if (count + read_size > reply_size)
+		return -1;
+
+	pos = count;
+	for (uint32_t i = 0; i < count; i++) {
+		if (steps[i].type != I2C_STEP_READ)
+			continue;
+
+		steps[i].buf = &reply[pos];
+		for (uint32_t j = 0; j < steps[i].len; j++)
+			reply[pos + j] = 0;
+
+		pos += steps[i].len;
+	}
+
+	i2c_transfer_steps(i2c, steps, count);
+	for (uint32_t i = 0; i < count; i++)
+		reply[i] = steps[i].ok;
+
+	return count + read_size;
+}
+
+/* Receive lists of I2C steps and run them. Request blocks have the same format as blocks of
+ * write command. Each valid block is answered by 'R' and the reply block:
+ * | len_lo | len_hi | crc_lo | crc_hi | reply |.
+ */
+void cmd_i2c_batch(void)
+{
+	uint8_t req[I2C_BATCH_SIZE];
+	uint8_t reply[I2C_BATCH_SIZE];
+	uint16_t block_size;
+	uint16_t expected_crc;
+	uint16_t crc;
+	int len;
+
+	if (!i2c) {
+		uart_puts(UART0, "E\nI2C controller is not selected\n");
+		return;
+	}
+
+	uart_puts(UART0, "Ready for data\n#");
+	while (1) {
+		block_size = uart_getchar(UART0);
+		block_size |= (uint16_t)uart_getchar(UART0) << 8;
+		expected_crc = uart_getchar(UART0);
+		expected_crc |= (uint16_t)uart_getchar(UART0) << 8;
+		if (!block_size) {
+			uart_putc(UART0, '\n');
+			return;
+		} else if (block_size > sizeof(req)) {
+			uart_puts(UART0, "E\nBlock size is too large\n");
+			return;
+		}
+
+		crc = crc16_init();
+		for (unsigned i = 0; i < block_size; i++) {
+			req[i] = uart_getchar(UART0);
+			crc = crc16_update_byte(crc, req[i]);
+		}
+
+		if (crc != expected_crc) {
+			uart_putc(UART0, 'C');
+			continue;
+		}
+
+		len = i2c_batch_run(req, block_size, reply, sizeof(reply));
+		if (len < 0) {
+			uart_puts(UART0, "E\nWrong list of steps\n");
+			return;
+		}
+
+		crc = crc16_init();
+		for (int i = 0; i < len; i++)
+			crc = crc16_update_byte(crc, reply[i]);
+
+		uart_putc(UART0, 'R');
+		uart_putc_raw(UART0, len & 0xff);
+		uart_putc_raw(UART0, len >> 8);
+		uart_putc_raw(UART0, crc & 0xff);
+		uart_putc_raw(UART0, crc >> 8);
+		for (int i = 0; i < len; i++)
+			uart_putc_raw(UART0, reply[i]);
+	}
+}
+
+static bool eeprom_prepare(struct eeprom *eeprom, uint32_t addr, uint32_t alen,
+			   uint32_t page_size)
+{
+	if (!i2c) {
+		uart_puts(UART0, "E\nI2C controller is not selected\n");
+		return false;
+	}
+
+	if (alen < 1 || alen > 2) {
+		uart_puts(UART0, "E\nAddress length must be 1 or 2\n");
+		return false;
+	}
+
+	eeprom->i2c = i2c;
+	eeprom->addr = addr;
+	eeprom->alen = alen;
+	eeprom->page_size = page_size;
+
+	return true;
+}
+
+/* Write data to EEPROM. Data is received by blocks with the same format as for write command */
+void cmd_eeprom_write(uint32_t addr, uint32_t alen, uint32_t page_size, uint32_t offset)
+{
+	struct eeprom eeprom;
+	uint8_t buf[EEPROM_BLOCK_SIZE];
+	uint16_t block_size;
+	uint16_t expected_crc;
+	uint16_t crc;
+
+	if (page_size == 0 || page_size > EEPROM_BLOCK_SIZE) {
+		uart_printf(UART0, "E\nWrong page size. Must be 0 < page <= %d\n", EEPROM_BLOCK_SIZE);
+		return;
+	}
+
+	if (!eeprom_prepare(&eeprom, addr, alen, page_size))
+		return;
+
+	uart_puts(UART0, "Ready for data\n#");
+	while (1) {
+		block_size = uart_getchar(UART0);
+		block_size |= (uint16_t)uart_getchar(UART0) << 8;
+		expected_crc = uart_getchar(UART0);
+		expected_crc |= (uint16_t)uart_getchar(UART0) << 8;
+		if (!block_size) {
+			uart_putc(UART0, '\n');
+			return;
+		} else if (block_size > sizeof(buf)) {
+			uart_puts(UART0, "E\nBlock size is too large\n");
+			return;
+		}
+
+		crc = crc16_init();
+		for (unsigned i = 0; i < block_size; i++) {
+			buf[i] = uart_getchar(UART0);
+			crc = crc16_update_byte(crc, buf[i]);
+		}
+
+		if (crc != expected_crc) {
+			uart_putc(UART0, 'C');
+			continue;
+		}
+
+		if (!eeprom_write(&eeprom, offset, buf, block_size)) {
+			uart_printf(UART0, "E\nEEPROM write failed at offset %#x\n", offset);
+			return;
+		}
+		offset += block_size;
+		uart_putc(UART0, 'R');
+	}
+}
+
+void cmd_eeprom_read(uint32_t addr, uint32_t alen, uint32_t offset, uint32_t size, char *mode)
+{
+	struct eeprom eeprom;
+	uint8_t buf[I2C_BUFFER_SIZE];
+	bool is_bin;
+
+	if (!mode || !strcmp(mode, "text")) {
+		is_bin = false;
+	} else if (!strcmp(mode, "bin")) {
+		is_bin = true;
+	} else {
+		uart_puts(UART0, "Error: Unknown mode\n");
+		return;
+	}
+
+	if (!eeprom_prepare(&eeprom, addr, alen, 1))
+		return;
+
+	if (is_bin)
+		uart_putc(UART0, '#');
+	else
+		print_hexdump_header(offset);
+
+	while (size) {
+		uint32_t len = size > sizeof(buf) ? sizeof(buf) : size;
+
+		if (!eeprom_read(&eeprom, offset, buf, len)) {
+			uart_printf(UART0, "\nError: EEPROM read failed at offset %#x\n", offset);
+			return;
+		}
+
+		if (is_bin) {
+			for (uint32_t i = 0; i < len; i++)
+				uart_putc_raw(UART0, buf[i]); // Do not add \r to \n
+		} else {
+			print_hexdump_body(buf, offset, len);
+		}
+		size -= len;
+		offset += len;
+	}
+}
+
 void console_run(struct console *console, struct console_cmd *cmd, struct console_arg *args,
 		 int argc)
 {
+	uint32_t speed;
+
 	switch (cmd->cmd_id) {
 	case CMD_HELP:
 		console_help(console);
@@ -690,8 +1559,7 @@ void console_run(struct console *console, struct console_cmd *cmd, struct consol
 				    !!args[1].uint);
 		break;
 	case CMD_ERASE:
-		qspi_flash_write_enable();
-		qspi_flash_erase(args[0].uint);
+		flash_erase(args[0].uint);
 		uart_puts(UART0, "OK\n");
 		break;
 	case CMD_WRITE:
@@ -711,6 +1579,23 @@ void console_run(struct console *console, struct console_cmd *cmd, struct consol
 	case CMD_CUSTOM:
 		iface_custom(args[0].str, args[1].uint);
 		break;
+	case CMD_SPI_XFER:
+		iface_spi_xfer();
+		break;
+	case CMD_CLONE:
+		iface_clone(args[0].uint, args[1].uint, args[2].uint, args[3].uint);
+		break;
+	case CMD_MIRROR:
+		mirror_prepare(args[0].uint);
+		if (qspi_mirror)
+			uart_printf(UART0, "Mirror to QSPI%u enabled\n", qspi_mirror == QSPI1);
+		else
+			uart_puts(UART0, "Mirror disabled\n");
+		break;
+	case CMD_FEC:
+		fec_enabled = args[0].uint;
+		uart_printf(UART0, "FEC %s\n", fec_enabled ? "enabled" : "disabled");
+		break;
 #ifdef MIPS32
 	case CMD_BOOTROM:
 		run_bootrom();
@@ -720,9 +1605,22 @@ void console_run(struct console *console, struct console_cmd *cmd, struct consol
 	case CMD_EXIT:
 		need_exit = true;
 		break;
+	case CMD_WRITE_MULTI:
+		iface_write_multi(args[0].uint, args[1].uint, args[2].uint);
+		break;
+	case CMD_WRITE_MEM:
+		iface_write_mem(args[0].uint, args[1].addr, args[2].uint,
+				argc > 3 ? args[3].uint : 256);
+		break;
+	case CMD_VERIFY_MEM:
+		iface_verify_mem(args[0].uint, args[1].addr, args[2].uint);
+		break;
 #endif
 	case CMD_I2C_DEV:
-		cmd_i2c_dev(args[0].uint, args[1].uint);
+		speed = cmd_i2c_dev(args[0].uint, args[1].uint);
+		// Legacy speed values 0 and 1 are used by scripts that do not expect any output
+		if (speed && args[1].uint > 1)
+			uart_printf(UART0, "I2C speed %d Hz\n", speed);
 		break;
 	case CMD_I2C_READ:
 		cmd_i2c_read(args[0].uint, args[1].uint, args[2].uint, args[3].uint, args[4].str);
@@ -730,11 +1628,128 @@ void console_run(struct console *console, struct console_cmd *cmd, struct consol
 	case CMD_I2C_WRITE:
 		cmd_i2c_write(args[0].uint, args[1].uint, args[2].uint, args[3].uint);
 		break;
+	case CMD_I2C_BATCH:
+		cmd_i2c_batch();
+		break;
+	case CMD_EEPROM_WRITE:
+		cmd_eeprom_write(args[0].uint, args[1].uint, args[2].uint, args[3].uint);
+		break;
+	case CMD_EEPROM_READ:
+		cmd_eeprom_read(args[0].uint, args[1].uint, args[2].uint, args[3].uint, args[4].str);
+		break;
 	default:
 		break;
 	}
 }
 
+/* Handler of commands received in binary RPC mode. Data that text commands receive
+ * interactively (write, i2c_write) is taken from the RPC operation.
+ */
+int console_run_rpc(struct console *console, struct console_cmd *cmd, struct console_arg *args,
+		    int argc, uint8_t *data, uint32_t data_len)
+{
+	uint8_t buf[1024];
+	uint32_t offset;
+	uint32_t size;
+	uint32_t len;
+	uint16_t crc;
+	int reply_len;
+
+	switch (cmd->cmd_id) {
+	case CMD_QSPI:
+		return qspi_prepare(args[0].uint, args[1].uint) ? CONSOLE_RPC_ERR_ARGS :
+								  CONSOLE_RPC_OK;
+	case CMD_MIRROR:
+		mirror_prepare(args[0].uint);
+		return CONSOLE_RPC_OK;
+	case CMD_ERASE:
+		flash_erase(args[0].uint);
+		return CONSOLE_RPC_OK;
+	case CMD_WRITE:
+		offset = args[0].uint;
+		if (args[1].uint == 0 || args[1].uint > 32 * 1024)
+			return CONSOLE_RPC_ERR_ARGS;
+
+		while (data_len) {
+			len = args[1].uint - offset % args[1].uint;
+			if (len > data_len)
+				len = data_len;
+
+			flash_write_page(data, len, offset);
+			data += len;
+			offset += len;
+			data_len -= len;
+		}
+		return CONSOLE_RPC_OK;
+	case CMD_READ:
+		offset = args[0].uint;
+		size = args[1].uint;
+		if (size > 0xffff)
+			return CONSOLE_RPC_ERR_ARGS;
+
+		console_rpc_reply_start(console, CONSOLE_RPC_OK, size);
+		while (size) {
+			len = size > sizeof(buf) ? sizeof(buf) : size;
+			qspi_flash_read(qspi, buf, len, offset);
+			console_rpc_send(console, buf, len);
+			size -= len;
+			offset += len;
+		}
+		return CONSOLE_RPC_OK;
+	case CMD_READ_CRC:
+		crc = iface_read_crc(args[0].uint, args[1].uint);
+		buf[0] = crc & 0xff;
+		buf[1] = crc >> 8;
+		console_rpc_reply(console, CONSOLE_RPC_OK, buf, 2);
+		return CONSOLE_RPC_OK;
+	case CMD_SPI_XFER:
+		// Each RPC operation is a complete transaction, SS is never left asserted
+		reply_len = spi_xfer_run(data, data_len, buf, sizeof(buf));
+		qspi_deassert_ss(qspi);
+		if (reply_len < 0)
+			return CONSOLE_RPC_ERR_ARGS;
+
+		console_rpc_reply(console, CONSOLE_RPC_OK, buf, reply_len);
+		return CONSOLE_RPC_OK;
+	case CMD_I2C_DEV:
+		if (args[0].uint > 4)
+			return CONSOLE_RPC_ERR_ARGS;
+
+		cmd_i2c_dev(args[0].uint, args[1].uint);
+		return CONSOLE_RPC_OK;
+	case CMD_I2C_READ:
+		size = args[3].uint;
+		if (!i2c || size > I2C_BUFFER_SIZE)
+			return CONSOLE_RPC_ERR_ARGS;
+
+		if (!i2c_read(i2c, args[0].uint, args[1].uint, args[2].uint, buf, size))
+			return RPC_ERR_FAILED;
+
+		console_rpc_reply(console, CONSOLE_RPC_OK, buf, size);
+		return CONSOLE_RPC_OK;
+	case CMD_I2C_WRITE:
+		if (!i2c || args[3].uint != data_len || data_len > I2C_BUFFER_SIZE)
+			return CONSOLE_RPC_ERR_ARGS;
+
+		if (!i2c_write(i2c, args[0].uint, args[1].uint, args[2].uint, data, data_len))
+			return RPC_ERR_FAILED;
+
+		return CONSOLE_RPC_OK;
+	case CMD_I2C_BATCH:
+		if (!i2c)
+			return CONSOLE_RPC_ERR_ARGS;
+
+		reply_len = i2c_batch_run(data, data_len, buf, sizeof(buf));
+		if (reply_len < 0)
+			return CONSOLE_RPC_ERR_ARGS;
+
+		console_rpc_reply(console, CONSOLE_RPC_OK, buf, reply_len);
+		return CONSOLE_RPC_OK;
+	default:
+		return CONSOLE_RPC_ERR_UNSUPPORTED;
+	}
+}
+
 struct console console = {
 	.uart = UART0,
 	.cmds = console_cmd,
@@ -743,6 +1758,7 @@ struct console console = {
 	.app_name = APP_NAME,
 	.each_line_msg = APP_NAME,
 	.run_cmd = console_run,
+	.run_rpc = console_run_rpc,
 };
 
 #ifdef CAN_RETURN